@@ -0,0 +1,210 @@
+// Talkbox 数据库吞吐压测
+// 生成测试数据后，分别用单个读连接和每线程一个读连接运行只读查询，比较不同线程数下的吞吐量；
+// --query=send 时改为并发发送消息，比较每条消息单独提交与批量提交的吞吐量
+//
+// 用法: db_bench [选项]
+//   --db=/tmp/talkbox_bench.db  数据库文件（会被覆盖）
+//   --users=1000        用户数
+//   --messages=200000   私聊消息数
+//   --duration=3        每组压测时长（秒）
+//   --threads=1,2,4,8   线程数列表
+//   --query=messages    查询类型：messages（最近 50 条消息）、conversations（会话列表）、mixed 或 send（发送消息）
+
+#include "../src/database.h"
+
+#include <sqlite3.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct BenchConfig {
+    std::string db_path = "/tmp/talkbox_bench.db";
+    int users = 1000;
+    int messages = 200000;
+    int duration = 3;
+    std::vector<int> threads = {1, 2, 4, 8};
+    std::string query = "messages";
+};
+
+static void remove_database(const std::string& path) {
+    unlink(path.c_str());
+    unlink((path + "-wal").c_str());
+    unlink((path + "-shm").c_str());
+}
+
+// 绕过 Database 直接批量写入：注册用户需要计算密码哈希，逐条写入太慢
+static bool populate(const BenchConfig& config) {
+    remove_database(config.db_path);
+    { Database schema(config.db_path, 1); }
+
+    sqlite3* db = nullptr;
+    if (sqlite3_open(config.db_path.c_str(), &db) != SQLITE_OK) {
+        std::cerr << "无法打开数据库: " << config.db_path << std::endl;
+        return false;
+    }
+    sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr);
+
+    sqlite3_stmt* stmt;
+    sqlite3_prepare_v2(db, "INSERT INTO users (username, password) VALUES (?, 'x');", -1, &stmt, nullptr);
+    for (int i = 1; i <= config.users; ++i) {
+        std::string name = "bench_user_" + std::to_string(i);
+        sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> user(1, config.users);
+    sqlite3_prepare_v2(db, "INSERT INTO messages (sender_id, receiver_id, content, timestamp) "
+                           "VALUES (?, ?, 'benchmark message content', '2024-01-01 00:00:00');",
+                       -1, &stmt, nullptr);
+    for (int i = 0; i < config.messages; ++i) {
+        int sender = user(rng);
+        int receiver = user(rng);
+        sqlite3_bind_int(stmt, 1, sender);
+        sqlite3_bind_int(stmt, 2, receiver == sender ? receiver % config.users + 1 : receiver);
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+
+    // 会话列表在下次打开数据库时由已有消息生成
+    sqlite3_exec(db, "DELETE FROM conversations; COMMIT;", nullptr, nullptr, nullptr);
+    sqlite3_close(db);
+    return true;
+}
+
+static double cache_hit_rate = 0;  // 最近一组压测的预编译语句缓存命中率
+
+// 运行一组压测，返回每秒查询数
+static double run_case(const BenchConfig& config, int threads, int readers,
+                       WriteBatchConfig batch = WriteBatchConfig()) {
+    Database database(config.db_path, readers, batch);
+    std::atomic<bool> stop(false);
+    std::vector<uint64_t> counts(threads, 0);
+    std::vector<std::thread> workers;
+
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            std::mt19937 rng(t + 1);
+            std::uniform_int_distribution<int> user(1, config.users);
+            uint64_t n = 0;
+            while (!stop) {
+                int user_id = user(rng);
+                if (config.query == "send") {
+                    Message message{-1, user_id, "", user_id % config.users + 1, -1,
+                                    "benchmark message content", "2024-01-01 00:00:00", "text"};
+                    database.save_message(message);
+                    ++n;
+                    continue;
+                }
+                bool conversations = config.query == "conversations" || (config.query == "mixed" && (n & 1));
+                if (conversations) {
+                    database.get_conversations(user_id, -1, 20);
+                } else {
+                    database.get_messages(user_id, 50);
+                }
+                ++n;
+            }
+            counts[t] = n;
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(config.duration));
+    stop = true;
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    uint64_t total = 0;
+    for (uint64_t c : counts) {
+        total += c;
+    }
+    StatementCacheStats stats = database.statement_cache_stats();
+    if (stats.hits + stats.misses > 0) {
+        cache_hit_rate = static_cast<double>(stats.hits) / (stats.hits + stats.misses);
+    }
+    return static_cast<double>(total) / config.duration;
+}
+
+static bool parse_arguments(int argc, char* argv[], BenchConfig& config) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string name = arg.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+        if (name == "--db") config.db_path = value;
+        else if (name == "--users") config.users = std::max(2, std::atoi(value.c_str()));
+        else if (name == "--messages") config.messages = std::max(1, std::atoi(value.c_str()));
+        else if (name == "--duration") config.duration = std::max(1, std::atoi(value.c_str()));
+        else if (name == "--query" && (value == "messages" || value == "conversations" || value == "mixed" || value == "send")) {
+            config.query = value;
+        } else if (name == "--threads") {
+            config.threads.clear();
+            std::stringstream ss(value);
+            std::string item;
+            while (std::getline(ss, item, ',')) {
+                int n = std::atoi(item.c_str());
+                if (n > 0) config.threads.push_back(n);
+            }
+            if (config.threads.empty()) return false;
+        } else {
+            std::cerr << "未知选项: " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    BenchConfig config;
+    if (!parse_arguments(argc, argv, config)) {
+        return 1;
+    }
+
+    std::cout << "生成测试数据: " << config.users << " 个用户, " << config.messages << " 条消息" << std::endl;
+    if (!populate(config)) {
+        return 1;
+    }
+    { Database warmup(config.db_path, 1); }
+
+    std::cout << "查询: " << config.query << ", 每组 " << config.duration << " 秒" << std::endl;
+    if (config.query == "send") {
+        // 每个发送线程同时最多等待一条消息，批量大小不超过线程数
+        WriteBatchConfig single;
+        single.max_rows = 1;
+        single.window_ms = 0;
+        std::printf("%8s %16s %16s %8s\n", "线程数", "逐条提交 qps", "批量提交 qps", "加速比");
+        for (int threads : config.threads) {
+            double unbatched = run_case(config, threads, 1, single);
+            double batched = run_case(config, threads, 1);
+            std::printf("%8d %16.0f %16.0f %7.2fx\n", threads, unbatched, batched,
+                        unbatched > 0 ? batched / unbatched : 0.0);
+        }
+        remove_database(config.db_path);
+        return 0;
+    }
+
+    std::printf("%8s %16s %16s %8s\n", "线程数", "单连接 qps", "连接池 qps", "加速比");
+    for (int threads : config.threads) {
+        double single = run_case(config, threads, 1);
+        double pooled = run_case(config, threads, threads);
+        std::printf("%8d %16.0f %16.0f %7.2fx\n", threads, single, pooled, single > 0 ? pooled / single : 0.0);
+    }
+
+    std::printf("预编译语句缓存命中率: %.4f\n", cache_hit_rate);
+
+    remove_database(config.db_path);
+    return 0;
+}
@@ -0,0 +1,209 @@
+// Talkbox HTTP 压测工具
+// 每个连接一个线程，闭环发送请求并统计吞吐量和延迟分位数
+//
+// 用法: http_bench [选项]
+//   --host=127.0.0.1      服务器地址
+//   --port=8080           服务器端口
+//   --connections=32      并发连接数
+//   --duration=5          压测时长（秒）
+//   --path=/api/get_posts?page_size=1   请求路径
+//   --new-conn            每个请求新建一个连接（测试 accept 吞吐）
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct BenchConfig {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    int connections = 32;
+    int duration = 5;
+    std::string path = "/api/get_posts?page_size=1";
+    bool new_conn = false;
+};
+
+struct WorkerResult {
+    std::vector<double> latencies_us;
+    uint64_t errors = 0;
+    uint64_t status_503 = 0;
+    uint64_t reconnects = 0;  // 服务器主动关闭持久连接后重新连接的次数
+};
+
+static int connect_to(const BenchConfig& config) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == -1) return -1;
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(config.port);
+    inet_pton(AF_INET, config.host.c_str(), &addr.sin_addr);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) == -1) {
+        close(fd);
+        return -1;
+    }
+    int opt = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    return fd;
+}
+
+// 读取一个完整响应，返回状态码，失败返回 -1；服务器要求关闭连接时 close_requested 为 true
+static int read_response(int fd, std::string& buffer, bool& close_requested) {
+    while (true) {
+        size_t header_end = buffer.find("\r\n\r\n");
+        if (header_end != std::string::npos) {
+            size_t content_length = 0;
+            size_t pos = buffer.find("Content-Length:");
+            if (pos != std::string::npos && pos < header_end) {
+                content_length = std::strtoul(buffer.c_str() + pos + 15, nullptr, 10);
+            }
+            size_t total = header_end + 4 + content_length;
+            if (buffer.size() >= total) {
+                int status = std::atoi(buffer.c_str() + 9);
+                size_t close_pos = buffer.find("Connection: close");
+                close_requested = close_pos != std::string::npos && close_pos < header_end;
+                buffer.erase(0, total);
+                return status;
+            }
+        }
+
+        char chunk[16384];
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) return -1;
+        buffer.append(chunk, n);
+    }
+}
+
+static void run_worker(const BenchConfig& config, std::atomic<bool>& stop, WorkerResult& result) {
+    std::string request = "GET " + config.path + " HTTP/1.1\r\nHost: " + config.host + "\r\n";
+    if (config.new_conn) {
+        request += "Connection: close\r\n";
+    }
+    request += "\r\n";
+
+    int fd = -1;
+    std::string buffer;
+    while (!stop) {
+        if (fd == -1) {
+            fd = connect_to(config);
+            buffer.clear();
+            if (fd == -1) {
+                ++result.errors;
+                continue;
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        if (send(fd, request.data(), request.size(), MSG_NOSIGNAL) != (ssize_t)request.size()) {
+            ++result.errors;
+            close(fd);
+            fd = -1;
+            continue;
+        }
+        bool close_requested = false;
+        int status = read_response(fd, buffer, close_requested);
+        auto end = std::chrono::steady_clock::now();
+
+        if (status == -1) {
+            ++result.errors;
+            close(fd);
+            fd = -1;
+            continue;
+        }
+        if (status == 503) {
+            ++result.status_503;
+        }
+        result.latencies_us.push_back(
+            std::chrono::duration<double, std::micro>(end - start).count());
+
+        if (config.new_conn || close_requested) {
+            close(fd);
+            fd = -1;
+            if (!config.new_conn) {
+                ++result.reconnects;
+            }
+        }
+    }
+    if (fd != -1) {
+        close(fd);
+    }
+}
+
+static bool parse_arguments(int argc, char* argv[], BenchConfig& config) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string name = arg.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+        if (name == "--host") config.host = value;
+        else if (name == "--port") config.port = std::atoi(value.c_str());
+        else if (name == "--connections") config.connections = std::max(1, std::atoi(value.c_str()));
+        else if (name == "--duration") config.duration = std::max(1, std::atoi(value.c_str()));
+        else if (name == "--path") config.path = value;
+        else if (name == "--new-conn") config.new_conn = true;
+        else {
+            std::cerr << "未知选项: " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    BenchConfig config;
+    if (!parse_arguments(argc, argv, config)) {
+        return 1;
+    }
+
+    std::atomic<bool> stop(false);
+    std::vector<WorkerResult> results(config.connections);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < config.connections; ++i) {
+        threads.emplace_back([&, i]() { run_worker(config, stop, results[i]); });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(config.duration));
+    stop = true;
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    std::vector<double> latencies;
+    uint64_t errors = 0;
+    uint64_t status_503 = 0;
+    uint64_t reconnects = 0;
+    for (auto& r : results) {
+        latencies.insert(latencies.end(), r.latencies_us.begin(), r.latencies_us.end());
+        errors += r.errors;
+        status_503 += r.status_503;
+        reconnects += r.reconnects;
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    auto percentile = [&](double p) -> double {
+        if (latencies.empty()) return 0;
+        size_t idx = std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()));
+        return latencies[idx];
+    };
+
+    printf("path=%s connections=%d duration=%ds%s\n", config.path.c_str(), config.connections,
+           config.duration, config.new_conn ? " new-conn" : "");
+    printf("requests=%zu rps=%.0f p50=%.0fus p99=%.0fus max=%.0fus errors=%llu 503=%llu reconnects=%llu\n",
+           latencies.size(), latencies.size() / static_cast<double>(config.duration),
+           percentile(0.50), percentile(0.99), latencies.empty() ? 0.0 : latencies.back(),
+           (unsigned long long)errors, (unsigned long long)status_503, (unsigned long long)reconnects);
+    return 0;
+}
@@ -0,0 +1,139 @@
+// Talkbox 会话表压测
+// 登录指定数量的用户后，多个线程并发调用 authenticate(token, username)，
+// 比较单个分片（相当于一把全局锁）与分片会话表在不同在线用户数、线程数下的吞吐量
+//
+// 用法: session_bench [选项]
+//   --users=1000,100000  在线用户数列表
+//   --shards=16          分片数
+//   --duration=2         每组压测时长（秒）
+//   --threads=1,8,32     线程数列表
+
+#include "../src/session_table.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct BenchConfig {
+    std::vector<int> users = {1000, 100000};
+    int shards = 16;
+    int duration = 2;
+    std::vector<int> threads = {1, 8, 32};
+};
+
+struct Credential {
+    std::string token;
+    std::string username;
+};
+
+static uint64_t steady_now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 运行一组压测，返回每秒认证次数；认证失败时返回 -1
+static double run_case(const BenchConfig& config, int users, int shards, int threads) {
+    SessionTable sessions(shards, 1000, steady_now_ms());
+    sessions.set_ttl(3600 * 1000ull);
+    std::vector<Credential> credentials(users);
+    for (int i = 0; i < users; ++i) {
+        User user{i + 1, "user_" + std::to_string(i + 1), "", true, i + 1000, "", 0, 0};
+        bool was_online;
+        credentials[i].token = sessions.login(user, was_online);
+        credentials[i].username = user.username;
+    }
+
+    std::atomic<bool> stop(false);
+    std::atomic<bool> failed(false);
+    std::vector<uint64_t> counts(threads, 0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            std::mt19937 rng(t + 1);
+            std::uniform_int_distribution<int> user(0, users - 1);
+            uint64_t n = 0;
+            while (!stop) {
+                const Credential& credential = credentials[user(rng)];
+                if (sessions.authenticate(credential.token, credential.username) == -1) {
+                    failed = true;
+                }
+                ++n;
+            }
+            counts[t] = n;
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(config.duration));
+    stop = true;
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    uint64_t total = 0;
+    for (uint64_t c : counts) {
+        total += c;
+    }
+    return failed ? -1 : static_cast<double>(total) / config.duration;
+}
+
+static bool parse_list(const std::string& value, std::vector<int>& list) {
+    list.clear();
+    std::stringstream ss(value);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        int n = std::atoi(item.c_str());
+        if (n > 0) list.push_back(n);
+    }
+    return !list.empty();
+}
+
+static bool parse_arguments(int argc, char* argv[], BenchConfig& config) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string name = arg.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+        if (name == "--shards") config.shards = std::max(1, std::atoi(value.c_str()));
+        else if (name == "--duration") config.duration = std::max(1, std::atoi(value.c_str()));
+        else if (name == "--users") {
+            if (!parse_list(value, config.users)) return false;
+        } else if (name == "--threads") {
+            if (!parse_list(value, config.threads)) return false;
+        } else {
+            std::cerr << "未知选项: " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    BenchConfig config;
+    if (!parse_arguments(argc, argv, config)) {
+        return 1;
+    }
+
+    std::cout << "每组 " << config.duration << " 秒，分片数 " << config.shards << std::endl;
+    std::printf("%10s %8s %16s %16s %8s\n", "在线用户", "线程数", "单分片 qps", "分片 qps", "加速比");
+    for (int users : config.users) {
+        for (int threads : config.threads) {
+            double single = run_case(config, users, 1, threads);
+            double sharded = run_case(config, users, config.shards, threads);
+            if (single < 0 || sharded < 0) {
+                std::printf("认证失败\n");
+                return 1;
+            }
+            std::printf("%10d %8d %16.0f %16.0f %7.2fx\n", users, threads, single, sharded,
+                        single > 0 ? sharded / single : 0.0);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,160 @@
+// Talkbox 用户目录压测
+// 生成测试用户后从数据库载入用户目录，报告载入耗时、每百万用户占用的内存、
+// 各种查找的耗时以及布隆过滤器对不存在用户名的误判率
+//
+// 用法: user_directory_bench [选项]
+//   --db=/tmp/talkbox_users.db  数据库文件（会被覆盖）
+//   --users=1000000     用户数
+//   --lookups=2000000   每种查找的次数
+
+#include "../src/database.h"
+#include "../src/user_directory.h"
+
+#include <sqlite3.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+struct BenchConfig {
+    std::string db_path = "/tmp/talkbox_users.db";
+    int users = 1000000;
+    int lookups = 2000000;
+};
+
+static void remove_database(const std::string& path) {
+    unlink(path.c_str());
+    unlink((path + "-wal").c_str());
+    unlink((path + "-shm").c_str());
+}
+
+static std::string user_name(int i) {
+    return "user_" + std::to_string(i);
+}
+
+// 绕过 Database 直接批量写入：注册用户需要计算密码哈希，逐条写入太慢
+static bool populate(const BenchConfig& config) {
+    remove_database(config.db_path);
+    { Database schema(config.db_path, 1); }
+
+    sqlite3* db = nullptr;
+    if (sqlite3_open(config.db_path.c_str(), &db) != SQLITE_OK) {
+        std::cerr << "无法打开数据库: " << config.db_path << std::endl;
+        return false;
+    }
+    sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr);
+    sqlite3_stmt* stmt;
+    sqlite3_prepare_v2(db, "INSERT INTO users (username, password) VALUES (?, 'x');", -1, &stmt, nullptr);
+    for (int i = 1; i <= config.users; ++i) {
+        std::string name = user_name(i);
+        sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    sqlite3_close(db);
+    return true;
+}
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool parse_arguments(int argc, char* argv[], BenchConfig& config) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string name = arg.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+        if (name == "--db") config.db_path = value;
+        else if (name == "--users") config.users = std::max(1, std::atoi(value.c_str()));
+        else if (name == "--lookups") config.lookups = std::max(1, std::atoi(value.c_str()));
+        else {
+            std::cerr << "未知选项: " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    BenchConfig config;
+    if (!parse_arguments(argc, argv, config)) {
+        return 1;
+    }
+
+    std::cout << "生成测试数据: " << config.users << " 个用户" << std::endl;
+    if (!populate(config)) {
+        return 1;
+    }
+
+    UserDirectory directory;
+    double load_ms;
+    {
+        Database database(config.db_path, 1);
+        auto start = std::chrono::steady_clock::now();
+        database.for_each_user([&](int user_id, std::string_view username) {
+            directory.add(user_id, username);
+        });
+        load_ms = elapsed_ms(start);
+    }
+    double bytes_per_user = static_cast<double>(directory.memory_bytes()) / directory.size();
+    std::printf("载入 %zu 个用户: %.0f ms\n", directory.size(), load_ms);
+    std::printf("内存: %.1f MB，每用户 %.1f 字节，每百万用户 %.1f MB\n",
+                directory.memory_bytes() / 1048576.0, bytes_per_user, bytes_per_user * 1e6 / 1048576.0);
+
+    // 查找顺序随机，避免连续的用户ID命中同一批缓存行
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> user(1, config.users);
+    std::vector<int> ids(config.lookups);
+    std::vector<std::string> names(config.lookups);
+    std::vector<std::string> missing(config.lookups);
+    for (int i = 0; i < config.lookups; ++i) {
+        ids[i] = user(rng);
+        names[i] = user_name(ids[i]);
+        missing[i] = "nobody_" + std::to_string(ids[i]);
+    }
+
+    size_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int id : ids) {
+        found += !directory.username(id).empty();
+    }
+    double id_ns = elapsed_ms(start) * 1e6 / config.lookups;
+
+    start = std::chrono::steady_clock::now();
+    for (const std::string& name : names) {
+        found += directory.user_id(name) != -1;
+    }
+    double name_ns = elapsed_ms(start) * 1e6 / config.lookups;
+
+    size_t bloom_passed = 0;
+    start = std::chrono::steady_clock::now();
+    for (const std::string& name : missing) {
+        found += directory.contains(name);
+    }
+    double missing_ns = elapsed_ms(start) * 1e6 / config.lookups;
+    for (const std::string& name : missing) {
+        bloom_passed += directory.might_contain(name);
+    }
+
+    std::printf("%-28s %8.1f ns\n", "用户ID -> 用户名", id_ns);
+    std::printf("%-28s %8.1f ns\n", "用户名 -> 用户ID", name_ns);
+    std::printf("%-28s %8.1f ns\n", "不存在的用户名", missing_ns);
+    std::printf("布隆过滤器误判率: %.4f\n", static_cast<double>(bloom_passed) / config.lookups);
+    if (found != static_cast<size_t>(config.lookups) * 2) {
+        std::printf("查找结果不正确: %zu\n", found);
+        remove_database(config.db_path);
+        return 1;
+    }
+
+    remove_database(config.db_path);
+    return 0;
+}
@@ -0,0 +1,43 @@
+#!/bin/bash
+
+# Talkbox 压测脚本：比较不同事件循环线程数和监听模式下的吞吐量
+# 用法: ./scripts/bench.sh [端口] [时长秒数]
+
+PORT=${1:-9100}
+DURATION=${2:-5}
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )"
+PROJECT_ROOT="$( dirname "$SCRIPT_DIR" )"
+SERVER="$PROJECT_ROOT/build/talkbox-server"
+BENCH="$PROJECT_ROOT/build/http_bench"
+
+if [ ! -x "$SERVER" ] || [ ! -x "$BENCH" ]; then
+    echo "请先运行 make && make bench"
+    exit 1
+fi
+
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "$WORK_DIR"' EXIT
+cd "$WORK_DIR"
+
+MAX_THREADS=$(nproc)
+
+run_case() {
+    local label="$1"
+    shift
+    "$SERVER" $PORT "$@" > server.log 2>&1 &
+    local pid=$!
+    sleep 1
+    echo "=== $label ($*) ==="
+    "$BENCH" --port=$PORT --duration=$DURATION --connections=64 --path="/api/post/invalid"
+    "$BENCH" --port=$PORT --duration=$DURATION --connections=64 --path="/api/post/invalid" --new-conn
+    kill $pid
+    wait $pid 2>/dev/null
+}
+
+threads=1
+while [ $threads -le $MAX_THREADS ]; do
+    run_case "单监听 socket, $threads 线程" --io-threads=$threads
+    run_case "SO_REUSEPORT, $threads 线程" --io-threads=$threads --reuseport --pin-cpus
+    threads=$((threads * 2))
+done
@@ -0,0 +1,43 @@
+#!/bin/bash
+
+# Talkbox 压测脚本：比较 epoll 与 io_uring 后端的每请求系统调用数和尾延迟
+# 系统调用数来自服务器退出时日志中的 I/O 统计
+# 用法: ./scripts/bench_io_backend.sh [端口] [时长秒数] [连接数]
+
+PORT=${1:-9100}
+DURATION=${2:-5}
+CONNECTIONS=${3:-64}
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )"
+PROJECT_ROOT="$( dirname "$SCRIPT_DIR" )"
+SERVER="$PROJECT_ROOT/build/talkbox-server"
+BENCH="$PROJECT_ROOT/build/http_bench"
+
+if [ ! -x "$SERVER" ] || [ ! -x "$BENCH" ]; then
+    echo "请先运行 make && make bench"
+    exit 1
+fi
+
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "$WORK_DIR"' EXIT
+cd "$WORK_DIR"
+
+run_case() {
+    local backend="$1"
+    shift
+    rm -f talkbox.log
+    "$SERVER" $PORT --io-backend=$backend "$@" > server.log 2>&1 &
+    local pid=$!
+    sleep 1
+    echo "=== $backend ==="
+    "$BENCH" --port=$PORT --duration=$DURATION --connections=$CONNECTIONS --path="/api/post/invalid" "${BENCH_ARGS[@]}"
+    kill $pid
+    wait $pid 2>/dev/null
+    grep -o "I/O 统计:.*" talkbox.log
+}
+
+for BENCH_ARGS in "" "--new-conn"; do
+    BENCH_ARGS=($BENCH_ARGS)
+    run_case epoll
+    run_case io_uring
+done
@@ -0,0 +1,79 @@
+#!/bin/bash
+
+# Talkbox 每请求 SQL 查询数统计：准备一批消息、帖子和回复后逐个请求列表接口，
+# 用 /api/stats/db 中预编译语句的使用次数（命中 + 编译）计算每个请求执行的查询数
+# 用法: ./scripts/bench_queries.sh [端口] [每个列表的行数]
+
+PORT=${1:-9101}
+ROWS=${2:-200}
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )"
+PROJECT_ROOT="$( dirname "$SCRIPT_DIR" )"
+SERVER="${SERVER:-$PROJECT_ROOT/build/talkbox-server}"
+URL="http://localhost:$PORT"
+
+if [ ! -x "$SERVER" ]; then
+    echo "请先运行 make"
+    exit 1
+fi
+
+WORK_DIR=$(mktemp -d)
+"$SERVER" $PORT > "$WORK_DIR/server.log" 2>&1 &
+SERVER_PID=$!
+trap 'kill $SERVER_PID 2>/dev/null; wait $SERVER_PID 2>/dev/null; rm -rf "$WORK_DIR"' EXIT
+cd "$WORK_DIR"
+sleep 1
+
+post() {
+    curl -s -X POST "$URL$1" -H "Content-Type: application/json" -H "Authorization: Bearer $2" -d "$3"
+}
+
+# 两个用户互发消息，并在同一个群组和同一个帖子下各写 ROWS 行
+for name in bench_alice bench_bob; do
+    post /api/register "" "{\"username\":\"$name\",\"password\":\"123456\"}" > /dev/null
+done
+ALICE_LOGIN=$(post /api/login "" '{"username":"bench_alice","password":"123456"}')
+ALICE_TOKEN=$(echo "$ALICE_LOGIN" | jq -r '.data.token')
+ALICE_ID=$(echo "$ALICE_LOGIN" | jq -r '.data.user_id')
+BOB_LOGIN=$(post /api/login "" '{"username":"bench_bob","password":"123456"}')
+BOB_TOKEN=$(echo "$BOB_LOGIN" | jq -r '.data.token')
+BOB_ID=$(echo "$BOB_LOGIN" | jq -r '.data.user_id')
+
+post /api/create_group "$ALICE_TOKEN" '{"username":"bench_alice","group_name":"bench","description":""}' > /dev/null
+GROUP_ID=$(curl -s "$URL/api/get_groups" | jq -r '.data[-1].group_id')
+post /api/join_group "$BOB_TOKEN" "{\"username\":\"bench_bob\",\"group_id\":\"$GROUP_ID\"}" > /dev/null
+post /api/create_post "$ALICE_TOKEN" '{"username":"bench_alice","title":"bench","content":"bench"}' > /dev/null
+POST_ID=$(curl -s "$URL/api/get_posts?page_size=1" | jq -r '.data[0].post_id')
+
+for i in $(seq $ROWS); do
+    if [ $((i % 2)) -eq 0 ]; then
+        name=bench_alice; token=$ALICE_TOKEN; peer=$BOB_ID
+    else
+        name=bench_bob; token=$BOB_TOKEN; peer=$ALICE_ID
+    fi
+    post /api/send_message "$token" "{\"username\":\"$name\",\"receiver_id\":\"$peer\",\"content\":\"m$i\"}" > /dev/null
+    post /api/send_message "$token" "{\"username\":\"$name\",\"group_id\":\"$GROUP_ID\",\"content\":\"g$i\"}" > /dev/null
+    post /api/create_post "$token" "{\"username\":\"$name\",\"title\":\"t$i\",\"content\":\"c$i\"}" > /dev/null
+    post /api/reply_post "$token" "{\"username\":\"$name\",\"post_id\":\"$POST_ID\",\"content\":\"r$i\"}" > /dev/null
+done
+
+statements() {
+    curl -s "$URL/api/stats/db?username=bench_alice" -H "Authorization: Bearer $ALICE_TOKEN" | jq '.data.statement_cache.hits + .data.statement_cache.misses'
+}
+
+measure() {
+    local label="$1" path="$2"
+    local before after
+    before=$(statements)
+    rows=$(curl -s "$URL$path" -H "Authorization: Bearer $ALICE_TOKEN" | jq '.data | length')
+    after=$(statements)
+    printf "%-22s %6s %10s\n" "$label" "$rows" "$((after - before))"
+}
+
+# 消息列表每页最多 200 条
+LIMIT=$(( ROWS < 200 ? ROWS : 200 ))
+printf "%-22s %6s %10s\n" "接口" "行数" "查询数"
+measure get_messages "/api/get_messages?username=bench_alice&limit=$LIMIT"
+measure get_group_messages "/api/get_group_messages?username=bench_alice&group_id=$GROUP_ID&limit=$LIMIT"
+measure get_posts "/api/get_posts?page_size=100"
+measure get_post_replies "/api/get_post_replies?username=bench_alice&post_id=$POST_ID"
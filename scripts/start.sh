@@ -3,6 +3,7 @@
 # Talkbox 服务器启动脚本
 
 PORT=${1:-8080}
+shift 2>/dev/null
 
 echo "启动 Talkbox 聊天服务器..."
 echo "端口: $PORT"
@@ -17,4 +18,4 @@ SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )"
 PROJECT_ROOT="$( dirname "$SCRIPT_DIR" )"
 
 # 启动服务器
-"$PROJECT_ROOT/build/talkbox-server" $PORT
+"$PROJECT_ROOT/build/talkbox-server" $PORT "$@"
@@ -440,6 +440,11 @@ echo "8.2 测试帖子分页..."
 curl -s -X GET "$SERVER_URL/api/get_posts?page=1&page_size=2" | jq '.has_more'
 echo ""
 
+echo "8.2.1 测试帖子游标分页..."
+NEXT_POST_ID=$(curl -s -X GET "$SERVER_URL/api/get_posts?page_size=1" | jq -r '.next_before_id')
+curl -s -X GET "$SERVER_URL/api/get_posts?before_id=$NEXT_POST_ID&page_size=1" | jq '{before_id, has_more, next_before_id}'
+echo ""
+
 echo "8.3 测试心跳接口..."
 curl -s -X POST $SERVER_URL/api/heartbeat \
   -H "Content-Type: application/json" \
@@ -464,6 +469,76 @@ curl -s -X POST $SERVER_URL/api/register \
   -d '{"username":"test@user","password":"123456"}' | jq .
 echo ""
 
+# ========================================
+# 查询计划检查
+# ========================================
+echo "=========================================="
+echo "9. 查询计划检查"
+echo "=========================================="
+
+echo "9.1 检查热点查询没有退化为全表扫描..."
+# 在临时目录中执行全部迁移，检查新建数据库上的执行计划
+SERVER_BIN="$(cd "$(dirname "$0")/.." && pwd)/build/talkbox-server"
+PLAN_DIR=$(mktemp -d)
+if ! (cd "$PLAN_DIR" && "$SERVER_BIN" --check-query-plans); then
+  rm -rf "$PLAN_DIR"
+  echo "查询计划检查失败：有热点查询需要全表扫描"
+  exit 1
+fi
+rm -rf "$PLAN_DIR"
+echo ""
+
+# ========================================
+# 会话有效期测试
+# ========================================
+echo "=========================================="
+echo "10. 会话有效期测试"
+echo "=========================================="
+
+# 另起一个会话有效期为 2 秒的服务器，脚本退出时（包括中途失败）停止
+TTL_PORT=${TTL_PORT:-18091}
+TTL_URL="http://localhost:$TTL_PORT"
+TTL_DIR=$(mktemp -d)
+SSE_PID=""
+(cd "$TTL_DIR" && exec "$SERVER_BIN" $TTL_PORT --session-ttl=2 > server.log 2>&1) &
+TTL_PID=$!
+stop_ttl_server() {
+  kill $SSE_PID $TTL_PID 2>/dev/null || true
+  wait $SSE_PID $TTL_PID 2>/dev/null || true
+  rm -rf "$TTL_DIR"
+}
+trap stop_ttl_server EXIT
+sleep 1
+curl -s -X POST $TTL_URL/api/register \
+  -H "Content-Type: application/json" \
+  -d '{"username":"ttl_user","password":"123456"}' > /dev/null
+TTL_TOKEN=$(curl -s -X POST $TTL_URL/api/login \
+  -H "Content-Type: application/json" \
+  -d '{"username":"ttl_user","password":"123456"}' | jq -r '.data.token')
+
+echo "10.1 保持 SSE 连接超过有效期，会话不应过期..."
+curl -s -N -H "Accept: text/event-stream" "$TTL_URL/api/events?token=$TTL_TOKEN" > /dev/null &
+SSE_PID=$!
+sleep 5
+if grep -q "会话过期" "$TTL_DIR/server.log"; then
+  echo "会话有效期测试失败：持有推送连接的会话被过期"
+  exit 1
+fi
+echo "会话仍然有效"
+echo ""
+
+echo "10.2 关闭 SSE 连接后会话应按有效期过期..."
+kill $SSE_PID 2>/dev/null || true
+wait $SSE_PID 2>/dev/null || true
+SSE_PID=""
+sleep 5
+if ! grep -q "会话过期: ttl_user" "$TTL_DIR/server.log"; then
+  echo "会话有效期测试失败：没有推送连接的会话没有过期"
+  exit 1
+fi
+echo "会话已过期"
+echo ""
+
 echo "=========================================="
 echo "测试完成！"
 echo "=========================================="
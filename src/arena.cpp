@@ -0,0 +1,111 @@
+#include "arena.h"
+
+namespace {
+ArenaStats g_arena_stats;
+
+// 请求之间保留的内存块上限，超出部分在 reset 时释放
+const size_t MAX_RETAINED_BLOCKS = 16;
+
+size_t align_up(size_t n, size_t alignment) {
+    return (n + alignment - 1) & ~(alignment - 1);
+}
+}  // namespace
+
+Arena::Arena() : current(0), offset(0), used_bytes(0), grew(false) {
+    add_block(blocks, BLOCK_SIZE);
+}
+
+Arena::~Arena() {
+    for (auto& block : blocks) {
+        g_arena_stats.bytes_reserved -= block.size;
+    }
+    for (auto& block : large_blocks) {
+        g_arena_stats.bytes_reserved -= block.size;
+    }
+}
+
+Arena::Block& Arena::add_block(std::vector<Block>& list, size_t size) {
+    list.push_back(Block{std::unique_ptr<char[]>(new char[size]), size});
+    g_arena_stats.bytes_reserved += size;
+    return list.back();
+}
+
+void* Arena::do_allocate(size_t bytes, size_t alignment) {
+    used_bytes += bytes;
+
+    if (bytes + alignment > BLOCK_SIZE) {
+        grew = true;
+        // new char[] 至少按 max_align_t 对齐，更严格的对齐多申请一些空间
+        Block& block = add_block(large_blocks, bytes + alignment);
+        size_t start = align_up(reinterpret_cast<uintptr_t>(block.data.get()), alignment) -
+                       reinterpret_cast<uintptr_t>(block.data.get());
+        return block.data.get() + start;
+    }
+
+    while (true) {
+        Block& block = blocks[current];
+        uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+        size_t start = align_up(base + offset, alignment) - base;
+        if (start + bytes <= block.size) {
+            offset = start + bytes;
+            return block.data.get() + start;
+        }
+        // 当前块放不下，换到下一个块（没有时向堆申请）
+        ++current;
+        offset = 0;
+        if (current == blocks.size()) {
+            grew = true;
+            add_block(blocks, BLOCK_SIZE);
+        }
+    }
+}
+
+void Arena::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    // 单调分配：内存在 reset() 时统一回收
+    (void)p;
+    (void)bytes;
+    (void)alignment;
+}
+
+bool Arena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+void Arena::reset() {
+    ++g_arena_stats.requests;
+    if (!grew) {
+        ++g_arena_stats.hits;
+    }
+    uint64_t peak = g_arena_stats.peak_request_bytes.load(std::memory_order_relaxed);
+    while (used_bytes > peak &&
+           !g_arena_stats.peak_request_bytes.compare_exchange_weak(peak, used_bytes,
+                                                                   std::memory_order_relaxed)) {
+    }
+
+    for (auto& block : large_blocks) {
+        g_arena_stats.bytes_reserved -= block.size;
+    }
+    large_blocks.clear();
+    while (blocks.size() > MAX_RETAINED_BLOCKS) {
+        g_arena_stats.bytes_reserved -= blocks.back().size;
+        blocks.pop_back();
+    }
+
+    current = 0;
+    offset = 0;
+    used_bytes = 0;
+    grew = false;
+}
+
+size_t Arena::bytes_in_use() const {
+    return used_bytes;
+}
+
+const ArenaStats& Arena::stats() {
+    return g_arena_stats;
+}
+
+Arena& request_arena() {
+    thread_local Arena arena;
+    return arena;
+}
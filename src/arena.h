@@ -0,0 +1,60 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <memory_resource>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+// 请求内存区统计（所有工作线程汇总），可从其他线程读取
+struct ArenaStats {
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> hits{0};                // 未向堆申请新内存块的请求数
+    std::atomic<uint64_t> bytes_reserved{0};      // 各内存区持有的内存块总大小
+    std::atomic<uint64_t> peak_request_bytes{0};  // 单个请求使用的最大字节数
+};
+
+// 单调分配的请求内存区：只分配、不单独释放，请求结束时 reset() 一次性回收
+// 作为 std::pmr 容器的内存资源，目前只承载各接口拼接 JSON 响应体的临时字符串。
+// HttpRequest 只是指向连接请求缓冲区的视图，本身不分配；HttpResponse 在 reset() 之后
+// 才交给事件循环发送，响应头和响应体仍在堆上；数据库层返回的 Message / Post 等也在堆上
+// 每个工作线程一个，通过 request_arena() 取得
+class Arena : public std::pmr::memory_resource {
+public:
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+    Arena();
+    ~Arena() override;
+
+    // 回到第一个内存块的起点，已申请的内存块保留给后续请求；超大块在此释放
+    void reset();
+    // 本次请求已分配的字节数
+    size_t bytes_in_use() const;
+
+    static const ArenaStats& stats();
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks;      // 固定大小的内存块，reset 后按顺序复用
+    std::vector<Block> large_blocks;  // 超过 BLOCK_SIZE 的单次分配
+    size_t current;                 // 正在使用的内存块下标
+    size_t offset;                  // 当前块中已使用的字节数
+    size_t used_bytes;
+    bool grew;                      // 本次请求是否向堆申请了新内存块
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    Block& add_block(std::vector<Block>& list, size_t size);
+};
+
+// 当前线程的请求内存区
+Arena& request_arena();
+
+#endif // ARENA_H
@@ -0,0 +1,49 @@
+#include "buffer_pool.h"
+
+BufferPool::BufferPool(size_t max_pooled, size_t max_buffer_size)
+    : max_pooled(max_pooled), max_buffer_size(max_buffer_size) {
+}
+
+std::string BufferPool::acquire() {
+    ++pool_stats.acquires;
+    ++pool_stats.buffers_in_use;
+    if (!free_buffers.empty()) {
+        // 后进先出，刚归还的缓冲区更可能还在 CPU 缓存中
+        std::string buffer = std::move(free_buffers.back());
+        free_buffers.pop_back();
+        ++pool_stats.hits;
+        pool_stats.bytes_pooled -= buffer.capacity();
+        return buffer;
+    }
+
+    std::string buffer;
+    buffer.reserve(BUFFER_SIZE);
+    return buffer;
+}
+
+void BufferPool::release(std::string& buffer) {
+    if (buffer.capacity() < BUFFER_SIZE) {
+        return;  // 不是从池中借出的缓冲区
+    }
+    --pool_stats.buffers_in_use;
+    if (free_buffers.size() >= max_pooled || buffer.capacity() > max_buffer_size) {
+        std::string().swap(buffer);
+        return;
+    }
+    buffer.clear();
+    pool_stats.bytes_pooled += buffer.capacity();
+    free_buffers.push_back(std::move(buffer));
+    buffer = std::string();
+}
+
+void BufferPool::ensure(std::string& buffer) {
+    if (buffer.capacity() < BUFFER_SIZE) {
+        std::string pooled = acquire();
+        pooled.append(buffer);
+        buffer.swap(pooled);
+    }
+}
+
+const BufferPoolStats& BufferPool::stats() const {
+    return pool_stats;
+}
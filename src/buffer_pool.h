@@ -0,0 +1,42 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+
+// 缓冲区池统计，可从其他线程读取
+struct BufferPoolStats {
+    std::atomic<uint64_t> acquires{0};
+    std::atomic<uint64_t> hits{0};            // 直接复用池中缓冲区的次数
+    std::atomic<uint64_t> buffers_in_use{0};  // 已借出未归还的缓冲区数
+    std::atomic<uint64_t> bytes_pooled{0};    // 池中空闲缓冲区的总容量
+};
+
+// 连接读缓冲区和请求缓冲区的复用池，每个 EventLoop 一个，只在所属线程中使用
+// 连接空闲时把缓冲区归还到池中，大量空闲的持久连接不再各自占用缓冲区，
+// 活跃连接借用已经分配好容量的缓冲区，避免反复 malloc 和扩容
+class BufferPool {
+public:
+    // 新分配缓冲区的初始容量
+    static const size_t BUFFER_SIZE = 16384;
+
+    BufferPool(size_t max_pooled = 1024, size_t max_buffer_size = 256 * 1024);
+
+    // 返回一个空的缓冲区，容量至少为 BUFFER_SIZE
+    std::string acquire();
+    // 归还缓冲区，调用后 buffer 为空且不占用内存；过大的缓冲区直接释放
+    void release(std::string& buffer);
+    // buffer 没有从池中借出的容量时借一个
+    void ensure(std::string& buffer);
+
+    const BufferPoolStats& stats() const;
+
+private:
+    std::vector<std::string> free_buffers;
+    size_t max_pooled;
+    size_t max_buffer_size;
+    BufferPoolStats pool_stats;
+};
+
+#endif // BUFFER_POOL_H
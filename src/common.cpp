@@ -5,6 +5,8 @@
 #include <iomanip>
 #include <random>
 #include <algorithm>
+#include <cctype>
+#include <charconv>
 #include <openssl/evp.h>
 #include <openssl/rand.h>
 // 获取当前时间戳
@@ -18,16 +20,23 @@ std::string get_current_timestamp() {
 }
 
 // 从JSON字符串中解析值
-std::string parse_json_value(const std::string& json, const std::string& key) {
-    // Debug: std::cout << "Parsing JSON: " << json << " for key: " << key << std::endl;
-    std::string search_key = "\"" + key + "\"";
-    size_t pos = json.find(search_key);
-    if (pos == std::string::npos) {
-        return "";
+std::string parse_json_value(std::string_view json, std::string_view key) {
+    // 查找 "key"
+    size_t pos = 0;
+    while (true) {
+        pos = json.find(key, pos);
+        if (pos == std::string_view::npos) {
+            return "";
+        }
+        if (pos > 0 && json[pos - 1] == '"' && pos + key.length() < json.length() &&
+            json[pos + key.length()] == '"') {
+            break;
+        }
+        pos += key.length();
     }
     
-    pos = json.find(":", pos);
-    if (pos == std::string::npos) {
+    pos = json.find(':', pos);
+    if (pos == std::string_view::npos) {
         return "";
     }
     
@@ -44,73 +53,83 @@ std::string parse_json_value(const std::string& json, const std::string& key) {
     // 处理字符串类型的值
     if (json[pos] == '\"') {
         size_t start = pos + 1;
-        size_t end = json.find("\"", start);
-        while (end != std::string::npos && json[end-1] == '\\') {
-            end = json.find("\"", end + 1);
+        size_t end = json.find('"', start);
+        while (end != std::string_view::npos && json[end-1] == '\\') {
+            end = json.find('"', end + 1);
         }
         
-        if (end == std::string::npos) {
+        if (end == std::string_view::npos) {
             return "";
         }
         
-        return json.substr(start, end - start);
+        return std::string(json.substr(start, end - start));
     }
     
     // 处理数字或其他非字符串类型的值
     size_t end = json.find_first_of(",}\n", pos);
-    if (end == std::string::npos) {
-        return json.substr(pos);
+    if (end == std::string_view::npos) {
+        return std::string(json.substr(pos));
     }
     
-    return json.substr(pos, end - pos);
+    return std::string(json.substr(pos, end - pos));
+}
+
+// 从查询字符串中解析参数，只匹配完整的参数名（"id" 不会匹配 "post_id=..."）
+std::string_view get_query_param(std::string_view query, std::string_view key) {
+    size_t pos = 0;
+    while (pos < query.length()) {
+        size_t end = query.find('&', pos);
+        if (end == std::string_view::npos) {
+            end = query.length();
+        }
+        std::string_view pair = query.substr(pos, end - pos);
+        if (pair.length() > key.length() && pair[key.length()] == '=' &&
+            pair.compare(0, key.length(), key) == 0) {
+            return pair.substr(key.length() + 1);
+        }
+        pos = end + 1;
+    }
+    return {};
 }
 
 // 创建JSON响应
-std::string create_json_response(const std::string& status, const std::string& data) {
+HttpResponse create_json_response(const std::string& status, const std::string& data) {
     std::string json_body;
-    
-    if (data.empty()) {
-        json_body = "{\"status\":\"" + status + "\",\"data\":\"\"}";
-    } else if (data[0] == '{' || data[0] == '[') {
-        json_body = "{\"status\":\"" + status + "\",\"data\":" + data + "}";
+    json_body.reserve(32 + status.length() + data.length());
+    json_body.append("{\"status\":\"").append(status).append("\",\"data\":");
+    if (!data.empty() && (data[0] == '{' || data[0] == '[')) {
+        json_body.append(data);
     } else {
-        json_body = "{\"status\":\"" + status + "\",\"data\":\"" + data + "\"}";
+        json_body.append("\"").append(data).append("\"");
     }
+    json_body.append("}");
     
     // 根据 status 确定 HTTP 状态码
-    std::string http_status;
-    if (status == "success") {
-        http_status = "HTTP/1.1 200 OK";
-    } else {
-        http_status = "HTTP/1.1 400 Bad Request";
-    }
-    
-    std::ostringstream oss;
-    oss << http_status << "\r\n";
-    oss << "Content-Type: application/json\r\n";
-    oss << "Content-Length: " << json_body.length() << "\r\n";
-    oss << "Connection: close\r\n";
-    oss << "Access-Control-Allow-Origin: *\r\n";
-    oss << "\r\n";
-    oss << json_body;
-    
-    return oss.str();
+    return HttpResponse(status == "success" ? 200 : 400, std::move(json_body));
 }
 
 // 安全的字符串转整数
-int safe_stoi(const std::string& s, int default_val) {
-    if (s.empty()) return default_val;
-    try {
-        return std::stoi(s);
-    } catch (const std::exception&) {
+int safe_stoi(std::string_view s, int default_val) {
+    // 与 std::stoi 一致：允许前导空白和正号，忽略数字之后的内容
+    size_t pos = 0;
+    while (pos < s.length() && std::isspace(static_cast<unsigned char>(s[pos]))) {
+        pos++;
+    }
+    if (pos < s.length() && s[pos] == '+') {
+        pos++;
+    }
+    int value = 0;
+    auto result = std::from_chars(s.data() + pos, s.data() + s.length(), value);
+    if (result.ec != std::errc()) {
         return default_val;
     }
+    return value;
 }
 
 // JSON 字符串转义
-std::string escape_json_string(const std::string& s) {
-    std::string result;
-    result.reserve(s.length() + 10);
+namespace {
+template <typename String>
+void append_escaped(String& result, std::string_view s) {
     for (char c : s) {
         switch (c) {
             case '"':  result += "\\\""; break;
@@ -130,9 +149,20 @@ std::string escape_json_string(const std::string& s) {
                 }
         }
     }
+}
+}  // namespace
+
+std::string escape_json_string(const std::string& s) {
+    std::string result;
+    result.reserve(s.length() + 10);
+    append_escaped(result, s);
     return result;
 }
 
+void append_escaped_json(std::pmr::string& out, std::string_view s) {
+    append_escaped(out, s);
+}
+
 // Base64 编码
 static const char base64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
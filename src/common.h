@@ -1,7 +1,11 @@
 #ifndef COMMON_H
 #define COMMON_H
 
+#include "http_response.h"
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <memory_resource>
 #include <vector>
 
 // 所有模块共享的数据结构
@@ -12,6 +16,8 @@ struct User {
     bool online;
     int socket_fd;
     std::string token;
+    long long last_seen = 0;     // 最后一次心跳或认证请求的时间（Unix 秒）
+    uint64_t session_timer = 0;  // 会话过期定时器
 };
 
 struct Group {
@@ -33,6 +39,29 @@ struct Message {
     std::string type;  // "text", "file"
 };
 
+// 会话列表中的一项：与一个私聊对象或一个群组的最近消息和未读数
+struct Conversation {
+    int peer_id;          // 私聊对象，群聊为 -1
+    std::string peer_username;
+    int group_id;         // 群组，私聊为 -1
+    std::string group_name;
+    int last_message_id;
+    int last_sender_id;
+    std::string preview;  // 最后一条消息的开头部分
+    std::string last_timestamp;
+    int unread_count;
+};
+
+// 增量同步结果：游标之后与用户相关的变更，按变更顺序合并
+struct SyncChanges {
+    int cursor;                        // 本次同步到的变更序号
+    bool has_more;                     // 变更数超过上限，需要用新游标继续同步
+    std::vector<Message> messages;     // 用户发送、收到的私聊消息和所在群组的消息
+    std::vector<Group> groups_joined;  // 新加入的群组
+    std::vector<int> groups_left;      // 已退出的群组ID
+    std::vector<User> contacts;        // 新注册的用户
+};
+
 struct Post {
     int post_id;
     int user_id;
@@ -54,14 +83,18 @@ struct Reply {
 
 // 共享的工具函数
 std::string get_current_timestamp();
-std::string parse_json_value(const std::string& json, const std::string& key);
-std::string create_json_response(const std::string& status, const std::string& data = "");
+std::string parse_json_value(std::string_view json, std::string_view key);
+// 从查询字符串中取出参数值（返回指向 query 的视图，不存在时为空）
+std::string_view get_query_param(std::string_view query, std::string_view key);
+HttpResponse create_json_response(const std::string& status, const std::string& data = "");
 
 // 安全的字符串转整数（防止 stoi 异常）
-int safe_stoi(const std::string& s, int default_val = -1);
+int safe_stoi(std::string_view s, int default_val = -1);
 
 // JSON 字符串转义（防止 JSON 注入）
 std::string escape_json_string(const std::string& s);
+// 把转义后的字符串追加到 out（用于在请求内存区中拼接 JSON）
+void append_escaped_json(std::pmr::string& out, std::string_view s);
 
 // Base64 编解码（用于二进制文件传输）
 std::string base64_encode(const std::string& input);
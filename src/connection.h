@@ -0,0 +1,47 @@
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include "http_response.h"
+#include <string>
+#include <deque>
+#include <memory>
+#include <atomic>
+
+class EventLoop;
+
+// 推送连接（WebSocket / SSE）发送队列的统计，事件循环线程更新，其他线程只读
+struct PushQueueStats {
+    std::atomic<size_t> depth{0};        // 当前排队的帧数
+    std::atomic<size_t> peak_depth{0};   // 排队帧数的最大值
+    std::atomic<uint64_t> dropped{0};    // 因队列溢出丢弃的帧数
+    std::atomic<uint64_t> overflows{0};  // 队列溢出的次数
+};
+
+// 单个客户端连接的状态，由所属的 EventLoop 线程独占访问
+struct Connection {
+    int fd;
+    EventLoop* loop;
+    std::string read_buffer;              // 尚未处理的请求数据，空闲时归还给 BufferPool
+    std::string request_buffer;           // 正在处理的请求，处理完成前工作线程只读访问
+    std::deque<HttpResponse> write_queue;  // 待发送的响应，按请求顺序排列
+    size_t write_offset;                   // write_queue 第一个响应中已发送的字节数
+    bool busy;                 // 是否有请求正在工作线程中处理
+    bool keep_alive;           // 当前请求处理完后是否保持连接
+    bool read_paused;          // 缓冲的请求数据已达上限，暂停读取
+    bool peer_closed;          // 对端已关闭写端，发送完剩余响应后关闭
+    bool close_after_write;    // 发送完 write_queue 后关闭连接
+    bool websocket;            // 已升级为 WebSocket，收到的数据按帧解析
+    bool event_stream;         // 已转为 SSE 事件流，只推送事件，收到的数据被丢弃
+    bool closed;
+    PushQueueStats push_stats;
+
+    Connection(int fd, EventLoop* loop)
+        : fd(fd), loop(loop), write_offset(0), busy(false), keep_alive(true),
+          read_paused(false), peer_closed(false), close_after_write(false), websocket(false),
+          event_stream(false), closed(false) {}
+    virtual ~Connection() = default;
+};
+
+using ConnectionPtr = std::shared_ptr<Connection>;
+
+#endif // CONNECTION_H
@@ -1,107 +1,569 @@
 #include "database.h"
 #include <iostream>
 #include <algorithm>
+#include <cstring>
+#include <thread>
 
 // 安全获取 sqlite3 文本字段
 static std::string safe_sqlite3_text(sqlite3_stmt* stmt, int col) {
     const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, col));
     return text ? std::string(text) : std::string();
 }
-Database::Database(const std::string& db_path) {
-    int rc = sqlite3_open(db_path.c_str(), &db);
-    if (rc) {
-        std::cerr << "无法打开数据库: " << sqlite3_errmsg(db) << std::endl;
-        db = nullptr;
+// 读取 post_id, user_id, title, content, timestamp, username 六列的帖子查询结果，读完后重置语句
+static void read_posts(sqlite3_stmt* stmt, std::vector<Post>& posts) {
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        Post post;
+        post.post_id = sqlite3_column_int(stmt, 0);
+        post.user_id = sqlite3_column_int(stmt, 1);
+        post.title = safe_sqlite3_text(stmt, 2);
+        post.content = safe_sqlite3_text(stmt, 3);
+        post.timestamp = safe_sqlite3_text(stmt, 4);
+        post.username = safe_sqlite3_text(stmt, 5);
+        posts.push_back(post);
+    }
+    sqlite3_reset(stmt);
+}
+
+// 连接只在借出它的线程中使用，关闭 SQLite 自带的连接级互斥锁
+static sqlite3* open_connection(const std::string& db_path, int flags) {
+    sqlite3* db = nullptr;
+    if (sqlite3_open_v2(db_path.c_str(), &db, flags | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK) {
+        std::cerr << "无法打开数据库: " << (db ? sqlite3_errmsg(db) : db_path) << std::endl;
+        sqlite3_close(db);
+        return nullptr;
+    }
+    // 写事务提交时读连接可能正在做检查点，短暂等待而不是立即返回 SQLITE_BUSY
+    sqlite3_busy_timeout(db, 5000);
+    return db;
+}
+
+// 热点查询。check_query_plans() 逐条检查执行计划，任何一条退化为全表扫描都视为失败
+
+// 消息列表的发送者用户名在同一条查询中按主键联表取出，不再逐行查询
+
+// 用户发送或收到的消息：OR 条件只能走全表扫描或合并后整体排序，拆成发送方、接收方两次
+// 只读索引的倒序范围扫描，各取前 N 个消息ID合并，再按主键取出这些消息
+static const char* const USER_MESSAGES_SQL = R"(
+    SELECT m.message_id, m.sender_id, m.receiver_id, m.group_id, m.content, m.type, m.timestamp, u.username
+    FROM messages m LEFT JOIN users u ON u.user_id = m.sender_id
+    WHERE m.message_id IN (
+        SELECT message_id FROM (SELECT message_id FROM messages WHERE sender_id = ?1 AND message_id < ?2
+                                ORDER BY message_id DESC LIMIT ?3)
+        UNION ALL
+        SELECT message_id FROM (SELECT message_id FROM messages WHERE receiver_id = ?1 AND message_id < ?2
+                                ORDER BY message_id DESC LIMIT ?3))
+    ORDER BY m.message_id DESC LIMIT ?3;
+)";
+
+static const char* const GROUP_MESSAGES_SQL = R"(
+    SELECT m.message_id, m.sender_id, m.receiver_id, m.group_id, m.content, m.type, m.timestamp, u.username
+    FROM messages m LEFT JOIN users u ON u.user_id = m.sender_id
+    WHERE m.group_id = ?1 AND m.message_id < ?2
+    ORDER BY m.message_id DESC LIMIT ?3;
+)";
+
+// 新消息：发给用户的私聊和用户所在群组的消息分别走接收方索引和群组索引
+static const char* const MESSAGES_SINCE_SQL = R"(
+    SELECT m.message_id, m.sender_id, m.receiver_id, m.group_id, m.content, m.type, m.timestamp, u.username
+    FROM messages m LEFT JOIN users u ON u.user_id = m.sender_id
+    WHERE m.sender_id != ?2 AND m.message_id IN (
+        SELECT message_id FROM messages WHERE receiver_id = ?2 AND message_id > ?1
+        UNION ALL
+        SELECT gmsg.message_id FROM group_members gm
+        JOIN messages gmsg ON gmsg.group_id = gm.group_id AND gmsg.message_id > ?1
+        WHERE gm.user_id = ?2)
+    ORDER BY m.message_id ASC LIMIT ?3;
+)";
+
+// 增量同步：只按该用户相关的索引取变更序号，不扫描其他用户的变更。
+// 自己发出的消息和成员关系变更走 idx_changes_user，收到的私聊走 idx_changes_receiver，
+// 群消息先从成员关系变更中取出加入过的群组，再按 idx_changes_group 取各群组的消息；
+// 群消息按发送时的成员关系过滤：该用户在此群组中序号小于这条消息的最近一次加入 / 退出变更须为加入。
+// 新联系人对所有用户都可见，走 idx_changes_contact
+static const char* const CHANGES_SINCE_SQL = R"(
+    SELECT c.seq, c.kind, c.user_id, c.group_id,
+           m.message_id, m.sender_id, m.receiver_id, m.group_id, m.content, m.type, m.timestamp, su.username,
+           g.group_name, g.description, g.creator_id, g.created_time,
+           u.username
+    FROM changes c
+    LEFT JOIN messages m ON c.kind = 'message' AND m.message_id = c.message_id
+    LEFT JOIN users su ON su.user_id = m.sender_id
+    LEFT JOIN groups g ON c.kind = 'join' AND g.group_id = c.group_id
+    LEFT JOIN users u ON c.kind = 'contact' AND u.user_id = c.user_id
+    WHERE c.seq IN (
+        SELECT seq FROM changes
+        WHERE user_id = ?3 AND seq > ?1 AND seq <= ?2 AND kind != 'contact'
+        UNION ALL
+        SELECT seq FROM changes
+        WHERE receiver_id = ?3 AND seq > ?1 AND seq <= ?2
+        UNION ALL
+        SELECT gc.seq FROM (
+            SELECT DISTINCT group_id FROM changes
+            WHERE user_id = ?3 AND kind IN ('join', 'leave')) mg
+        JOIN changes gc ON gc.group_id = mg.group_id AND gc.kind = 'message'
+            AND gc.seq > ?1 AND gc.seq <= ?2
+        WHERE (SELECT mc.kind FROM changes mc
+               WHERE mc.user_id = ?3 AND mc.group_id = gc.group_id AND mc.seq < gc.seq
+                   AND mc.kind IN ('join', 'leave')
+               ORDER BY mc.seq DESC LIMIT 1) = 'join'
+        UNION ALL
+        SELECT seq FROM changes
+        WHERE kind = 'contact' AND seq > ?1 AND seq <= ?2 AND user_id != ?3)
+    ORDER BY c.seq LIMIT ?4;
+)";
+
+// idx_conversations_recent 上的一次倒序范围扫描，名称按主键逐行查找
+static const char* const CONVERSATIONS_SQL = R"(
+    SELECT c.peer_id, u.username, c.group_id, g.group_name, c.last_message_id, c.last_sender_id,
+           c.preview, c.last_timestamp, c.unread_count
+    FROM conversations c
+    LEFT JOIN users u ON u.user_id = c.peer_id
+    LEFT JOIN groups g ON g.group_id = c.group_id
+    WHERE c.user_id = ? AND c.last_message_id < ?
+    ORDER BY c.last_message_id DESC LIMIT ?;
+)";
+
+static const char* const USER_GROUPS_SQL = R"(
+    SELECT g.group_id, g.group_name, g.description, g.creator_id, g.created_time
+    FROM groups g
+    INNER JOIN group_members gm ON g.group_id = gm.group_id
+    WHERE gm.user_id = ?
+    ORDER BY g.created_time;
+)";
+
+static const char* const POST_REPLIES_SQL = R"(
+    SELECT r.reply_id, r.post_id, r.user_id, r.content, r.timestamp, u.username
+    FROM replies r LEFT JOIN users u ON u.user_id = r.user_id
+    WHERE r.post_id = ? ORDER BY r.timestamp;
+)";
+
+static const char* const USER_BY_NAME_SQL = "SELECT user_id, username, password FROM users WHERE username = ?;";
+
+static const char* const GROUP_MEMBER_SQL = "SELECT 1 FROM group_members WHERE group_id = ? AND user_id = ?;";
+
+static const struct {
+    const char* name;
+    const char* sql;
+} HOT_QUERIES[] = {
+    {"get_messages", USER_MESSAGES_SQL},
+    {"get_group_messages", GROUP_MESSAGES_SQL},
+    {"get_messages_since", MESSAGES_SINCE_SQL},
+    {"get_changes_since", CHANGES_SINCE_SQL},
+    {"get_conversations", CONVERSATIONS_SQL},
+    {"get_user_groups", USER_GROUPS_SQL},
+    {"get_post_replies", POST_REPLIES_SQL},
+    {"verify_user", USER_BY_NAME_SQL},
+    {"is_user_in_group", GROUP_MEMBER_SQL},
+};
+
+Database::DbConnection::DbConnection(sqlite3* handle) : handle(handle) {
+}
+
+Database::DbConnection::~DbConnection() {
+    for (auto& pair : statements) {
+        sqlite3_finalize(pair.second);
+    }
+    sqlite3_close(handle);
+}
+
+int Database::DbConnection::prepare(const std::string& sql, sqlite3_stmt** stmt) {
+    auto it = statements.find(sql);
+    if (it != statements.end()) {
+        ++hits;
+        *stmt = it->second;
+        sqlite3_reset(*stmt);
+        sqlite3_clear_bindings(*stmt);
+    } else {
+        int rc = sqlite3_prepare_v2(handle, sql.c_str(), -1, stmt, nullptr);
+        if (rc != SQLITE_OK) {
+            return rc;
+        }
+        ++misses;
+        statements.emplace(sql, *stmt);
+    }
+    in_use.push_back(*stmt);
+    return SQLITE_OK;
+}
+
+void Database::DbConnection::reset_statements() {
+    // 未执行完的语句会一直占着读事务，WAL 无法做检查点
+    for (sqlite3_stmt* stmt : in_use) {
+        sqlite3_reset(stmt);
+    }
+    in_use.clear();
+}
+
+Database::Database(const std::string& db_path, int reader_count, WriteBatchConfig batch)
+    : batch_config(batch) {
+    batch_config.max_rows = std::max(1, batch_config.max_rows);
+    batch_config.window_ms = std::max(0, batch_config.window_ms);
+    
+    sqlite3* handle = open_connection(db_path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    if (!handle) {
         return;
     }
+    writer = std::make_unique<DbConnection>(handle);
     
+    // WAL 模式下读不阻塞写、写不阻塞读，多个读连接可以并行查询
+    execute_sql(*writer, "PRAGMA journal_mode=WAL;");
+    // 消息按批提交，每次提交都同步到磁盘的代价由一批消息分摊
+    execute_sql(*writer, "PRAGMA synchronous=FULL;");
     init_database();
+    writer->reset_statements();
+    
+    if (reader_count <= 0) {
+        reader_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (int i = 0; i < reader_count; ++i) {
+        handle = open_connection(db_path, SQLITE_OPEN_READONLY);
+        if (!handle) {
+            break;
+        }
+        readers.push_back(std::make_unique<DbConnection>(handle));
+        idle_readers.push_back(readers.back().get());
+    }
+    
+    message_writer = std::thread([this]() { run_message_writer(); });
 }
 
 Database::~Database() {
-    if (db) {
-        sqlite3_close(db);
+    // 写完已在排队的消息后再关闭连接
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        stopping = true;
+    }
+    pending_ready.notify_all();
+    if (message_writer.joinable()) {
+        message_writer.join();
     }
 }
 
-bool Database::init_database() {
-    std::string create_users_table = R"(
-        CREATE TABLE IF NOT EXISTS users (
-            user_id INTEGER PRIMARY KEY AUTOINCREMENT,
-            username TEXT UNIQUE NOT NULL,
-            password TEXT NOT NULL,
-            online INTEGER DEFAULT 0
-        );
-    )";
-    
-    std::string create_messages_table = R"(
-        CREATE TABLE IF NOT EXISTS messages (
-            message_id INTEGER PRIMARY KEY AUTOINCREMENT,
-            sender_id INTEGER NOT NULL,
-            receiver_id INTEGER,
-            group_id INTEGER,
-            content TEXT NOT NULL,
-            type TEXT DEFAULT 'text',
-            timestamp TEXT NOT NULL,
-            FOREIGN KEY (sender_id) REFERENCES users(user_id)
-        );
-    )";
+Database::DbConnection* Database::acquire_reader() {
+    std::unique_lock<std::mutex> lock(readers_mutex);
+    if (readers.empty()) {
+        return nullptr;
+    }
+    reader_available.wait(lock, [this]() { return !idle_readers.empty(); });
+    DbConnection* reader = idle_readers.back();
+    idle_readers.pop_back();
+    return reader;
+}
+
+void Database::release_reader(DbConnection* reader) {
+    if (!reader) {
+        return;
+    }
+    reader->reset_statements();
+    {
+        std::lock_guard<std::mutex> lock(readers_mutex);
+        idle_readers.push_back(reader);
+    }
+    reader_available.notify_one();
+}
+
+Database::ReadLease::ReadLease(Database& database) : database(database), conn(database.acquire_reader()) {
+}
+
+Database::ReadLease::~ReadLease() {
+    database.release_reader(conn);
+}
+
+int Database::ReadLease::prepare(const std::string& sql, sqlite3_stmt** stmt) {
+    return conn ? conn->prepare(sql, stmt) : SQLITE_MISUSE;
+}
+
+Database::WriteLease::WriteLease(Database& database) : lock(database.writer_mutex), conn(database.writer.get()) {
+}
+
+Database::WriteLease::~WriteLease() {
+    if (conn) {
+        conn->reset_statements();
+    }
+}
+
+int Database::WriteLease::prepare(const std::string& sql, sqlite3_stmt** stmt) {
+    return conn ? conn->prepare(sql, stmt) : SQLITE_MISUSE;
+}
+
+StatementCacheStats Database::statement_cache_stats() {
+    StatementCacheStats stats;
+    auto add = [&stats](const DbConnection& conn) {
+        stats.hits += conn.hits.load();
+        stats.misses += conn.misses.load();
+    };
+    if (writer) {
+        add(*writer);
+    }
+    for (const auto& reader : readers) {
+        add(*reader);
+    }
+    // 缓存的语句数等于编译次数
+    stats.statements = stats.misses;
+    return stats;
+}
+
+// 结构迁移，按版本号顺序执行。已发布的步骤不能修改，结构变化只能追加新的步骤；
+// 早于迁移机制创建的数据库版本号为 0，前几步都用 IF NOT EXISTS，对它们重复执行没有影响
+const std::vector<Database::Migration>& Database::migrations() {
+    static const std::vector<Migration> steps = {
+        {1, "基础表", R"(
+            CREATE TABLE IF NOT EXISTS users (
+                user_id INTEGER PRIMARY KEY AUTOINCREMENT,
+                username TEXT UNIQUE NOT NULL,
+                password TEXT NOT NULL,
+                online INTEGER DEFAULT 0
+            );
+            CREATE TABLE IF NOT EXISTS messages (
+                message_id INTEGER PRIMARY KEY AUTOINCREMENT,
+                sender_id INTEGER NOT NULL,
+                receiver_id INTEGER,
+                group_id INTEGER,
+                content TEXT NOT NULL,
+                type TEXT DEFAULT 'text',
+                timestamp TEXT NOT NULL,
+                FOREIGN KEY (sender_id) REFERENCES users(user_id)
+            );
+            CREATE TABLE IF NOT EXISTS groups (
+                group_id INTEGER PRIMARY KEY AUTOINCREMENT,
+                group_name TEXT NOT NULL,
+                description TEXT,
+                creator_id INTEGER NOT NULL,
+                created_time TEXT NOT NULL,
+                FOREIGN KEY (creator_id) REFERENCES users(user_id)
+            );
+            CREATE TABLE IF NOT EXISTS group_members (
+                member_id INTEGER PRIMARY KEY AUTOINCREMENT,
+                group_id INTEGER NOT NULL,
+                user_id INTEGER NOT NULL,
+                joined_time TEXT NOT NULL,
+                FOREIGN KEY (group_id) REFERENCES groups(group_id),
+                FOREIGN KEY (user_id) REFERENCES users(user_id),
+                UNIQUE(group_id, user_id)
+            );
+            CREATE TABLE IF NOT EXISTS posts (
+                post_id INTEGER PRIMARY KEY AUTOINCREMENT,
+                user_id INTEGER NOT NULL,
+                title TEXT NOT NULL,
+                content TEXT NOT NULL,
+                timestamp TEXT NOT NULL,
+                FOREIGN KEY (user_id) REFERENCES users(user_id)
+            );
+            CREATE TABLE IF NOT EXISTS replies (
+                reply_id INTEGER PRIMARY KEY AUTOINCREMENT,
+                post_id INTEGER NOT NULL,
+                user_id INTEGER NOT NULL,
+                content TEXT NOT NULL,
+                timestamp TEXT NOT NULL,
+                FOREIGN KEY (post_id) REFERENCES posts(post_id),
+                FOREIGN KEY (user_id) REFERENCES users(user_id)
+            );
+        )", nullptr},
+        
+        // 变更日志：写入消息、加入/退出群组、注册用户时由触发器追加一行，seq 即同步游标
+        {2, "变更日志", R"(
+            CREATE TABLE IF NOT EXISTS changes (
+                seq INTEGER PRIMARY KEY AUTOINCREMENT,
+                kind TEXT NOT NULL,
+                user_id INTEGER NOT NULL,
+                receiver_id INTEGER,
+                group_id INTEGER,
+                message_id INTEGER
+            );
+            CREATE TRIGGER IF NOT EXISTS messages_change AFTER INSERT ON messages BEGIN
+                INSERT INTO changes (kind, user_id, receiver_id, group_id, message_id)
+                VALUES ('message', NEW.sender_id, NEW.receiver_id, NEW.group_id, NEW.message_id);
+            END;
+            CREATE TRIGGER IF NOT EXISTS group_join_change AFTER INSERT ON group_members BEGIN
+                INSERT INTO changes (kind, user_id, group_id) VALUES ('join', NEW.user_id, NEW.group_id);
+            END;
+            CREATE TRIGGER IF NOT EXISTS group_leave_change AFTER DELETE ON group_members BEGIN
+                INSERT INTO changes (kind, user_id, group_id) VALUES ('leave', OLD.user_id, OLD.group_id);
+            END;
+            CREATE TRIGGER IF NOT EXISTS users_change AFTER INSERT ON users BEGIN
+                INSERT INTO changes (kind, user_id) VALUES ('contact', NEW.user_id);
+            END;
+        )", &Database::backfill_changes},
+        
+        // 会话列表：每个用户与每个私聊对象 / 群组一行，写入消息时在同一事务中更新，
+        // 首页按 (user_id, last_message_id) 索引倒序读取
+        {3, "会话列表", R"(
+            CREATE TABLE IF NOT EXISTS conversations (
+                user_id INTEGER NOT NULL,
+                peer_id INTEGER NOT NULL,
+                group_id INTEGER NOT NULL,
+                last_message_id INTEGER NOT NULL,
+                last_sender_id INTEGER NOT NULL,
+                preview TEXT NOT NULL,
+                last_timestamp TEXT NOT NULL,
+                unread_count INTEGER NOT NULL DEFAULT 0,
+                PRIMARY KEY (user_id, peer_id, group_id)
+            );
+            CREATE INDEX IF NOT EXISTS idx_conversations_recent ON conversations (user_id, last_message_id);
+        )", &Database::backfill_conversations},
+        
+        // 热点查询的索引。消息索引带上 message_id，按用户 / 群组定位后直接按消息ID倒序取前 N 条，
+        // 不需要排序；私聊和群聊消息各自只占一部分，用部分索引跳过另一类消息
+        {4, "热点查询索引", R"(
+            CREATE INDEX IF NOT EXISTS idx_messages_sender ON messages (sender_id, message_id);
+            CREATE INDEX IF NOT EXISTS idx_messages_receiver ON messages (receiver_id, message_id)
+                WHERE receiver_id IS NOT NULL;
+            CREATE INDEX IF NOT EXISTS idx_messages_group ON messages (group_id, message_id)
+                WHERE group_id IS NOT NULL;
+            CREATE INDEX IF NOT EXISTS idx_group_members_user ON group_members (user_id, group_id);
+            CREATE INDEX IF NOT EXISTS idx_replies_post ON replies (post_id, timestamp);
+        )", nullptr},
+        
+        // 成员关系变更索引：增量同步按 (用户, 群组) 倒序找消息之前最近的一次加入 / 退出
+        {5, "成员关系变更索引", R"(
+            CREATE INDEX IF NOT EXISTS idx_changes_membership ON changes (user_id, group_id, seq)
+                WHERE kind IN ('join', 'leave');
+        )", nullptr},
+        
+        // 增量同步按用户取变更的索引：自己发出的变更、收到的私聊、群组的消息、新联系人
+        {6, "变更日志用户索引", R"(
+            CREATE INDEX IF NOT EXISTS idx_changes_user ON changes (user_id, seq);
+            CREATE INDEX IF NOT EXISTS idx_changes_receiver ON changes (receiver_id, seq)
+                WHERE receiver_id IS NOT NULL;
+            CREATE INDEX IF NOT EXISTS idx_changes_group ON changes (group_id, seq)
+                WHERE kind = 'message' AND group_id IS NOT NULL;
+            CREATE INDEX IF NOT EXISTS idx_changes_contact ON changes (seq)
+                WHERE kind = 'contact';
+        )", nullptr},
+    };
+    return steps;
+}
+
+bool Database::check_query_plans() {
+    WriteLease db(*this);
+    if (!db) {
+        std::cerr << "数据库连接未初始化" << std::endl;
+        return false;
+    }
     
-    std::string create_groups_table = R"(
-        CREATE TABLE IF NOT EXISTS groups (
-            group_id INTEGER PRIMARY KEY AUTOINCREMENT,
-            group_name TEXT NOT NULL,
-            description TEXT,
-            creator_id INTEGER NOT NULL,
-            created_time TEXT NOT NULL,
-            FOREIGN KEY (creator_id) REFERENCES users(user_id)
+    bool all_ok = true;
+    for (const auto& query : HOT_QUERIES) {
+        sqlite3_stmt* stmt;
+        std::string sql = std::string("EXPLAIN QUERY PLAN ") + query.sql;
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+            std::cerr << query.name << ": " << sqlite3_errmsg(db) << std::endl;
+            all_ok = false;
+            continue;
+        }
+        
+        // SCAN 表示遍历整个表或整个索引；子查询的结果集（CO-ROUTINE / MATERIALIZE）本身很小，可以遍历。
+        // 只有一侧边界的主键范围（如 message_id < ? 且没有其他可用索引）同样会遍历大半个表
+        std::vector<std::string> plan;
+        std::vector<std::string> subqueries;
+        bool ok = true;
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            std::string detail = safe_sqlite3_text(stmt, 3);
+            plan.push_back(detail);
+            for (const char* prefix : {"CO-ROUTINE ", "MATERIALIZE "}) {
+                if (detail.rfind(prefix, 0) == 0) {
+                    subqueries.push_back(detail.substr(strlen(prefix)));
+                }
+            }
+            if (detail.rfind("SCAN ", 0) == 0) {
+                std::string target = detail.substr(5, detail.find(' ', 5) - 5);
+                bool subquery = target[0] == '(' || target == "CONSTANT" ||
+                                std::find(subqueries.begin(), subqueries.end(), target) != subqueries.end();
+                ok = ok && subquery;
+            }
+            if (detail.find("PRIMARY KEY (rowid<?)") != std::string::npos ||
+                detail.find("PRIMARY KEY (rowid>?)") != std::string::npos) {
+                ok = false;
+            }
+        }
+        sqlite3_finalize(stmt);
+        
+        std::cerr << (ok ? "[OK]   " : "[SCAN] ") << query.name << std::endl;
+        for (const std::string& detail : plan) {
+            std::cerr << "         " << detail << std::endl;
+        }
+        all_ok = all_ok && ok;
+    }
+    return all_ok;
+}
+
+bool Database::init_database() {
+    DbConnection& db = *writer;
+    if (!execute_sql(db, R"(
+        CREATE TABLE IF NOT EXISTS schema_version (
+            version INTEGER PRIMARY KEY,
+            description TEXT NOT NULL,
+            applied_time TEXT NOT NULL
         );
-    )";
+    )")) {
+        return false;
+    }
     
-    std::string create_group_members_table = R"(
-        CREATE TABLE IF NOT EXISTS group_members (
-            member_id INTEGER PRIMARY KEY AUTOINCREMENT,
-            group_id INTEGER NOT NULL,
-            user_id INTEGER NOT NULL,
-            joined_time TEXT NOT NULL,
-            FOREIGN KEY (group_id) REFERENCES groups(group_id),
-            FOREIGN KEY (user_id) REFERENCES users(user_id),
-            UNIQUE(group_id, user_id)
-        );
-    )";
+    sqlite3_stmt* stmt;
+    if (db.prepare("SELECT COALESCE(MAX(version), 0) FROM schema_version;", &stmt) != SQLITE_OK) {
+        return false;
+    }
+    int current = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : 0;
+    sqlite3_reset(stmt);
     
-    std::string create_posts_table = R"(
-        CREATE TABLE IF NOT EXISTS posts (
-            post_id INTEGER PRIMARY KEY AUTOINCREMENT,
-            user_id INTEGER NOT NULL,
-            title TEXT NOT NULL,
-            content TEXT NOT NULL,
-            timestamp TEXT NOT NULL,
-            FOREIGN KEY (user_id) REFERENCES users(user_id)
-        );
-    )";
+    if (current > migrations().back().version) {
+        std::cerr << "数据库结构版本 " << current << " 高于程序支持的版本 "
+                  << migrations().back().version << std::endl;
+        return false;
+    }
     
-    std::string create_replies_table = R"(
-        CREATE TABLE IF NOT EXISTS replies (
-            reply_id INTEGER PRIMARY KEY AUTOINCREMENT,
-            post_id INTEGER NOT NULL,
-            user_id INTEGER NOT NULL,
-            content TEXT NOT NULL,
-            timestamp TEXT NOT NULL,
-            FOREIGN KEY (post_id) REFERENCES posts(post_id),
-            FOREIGN KEY (user_id) REFERENCES users(user_id)
-        );
-    )";
+    // 每一步连同版本号在一个事务中提交，中途失败时下次启动从这一步重新执行
+    for (const Migration& step : migrations()) {
+        if (step.version <= current) {
+            continue;
+        }
+        std::cerr << "数据库迁移到版本 " << step.version << ": " << step.description << std::endl;
+        if (!execute_sql(db, "BEGIN IMMEDIATE;")) {
+            return false;
+        }
+        bool ok = execute_sql(db, step.sql) && (!step.backfill || (this->*step.backfill)());
+        if (ok && db.prepare("INSERT INTO schema_version (version, description, applied_time) VALUES (?, ?, ?);",
+                             &stmt) == SQLITE_OK) {
+            std::string applied_time = get_current_timestamp();
+            sqlite3_bind_int(stmt, 1, step.version);
+            sqlite3_bind_text(stmt, 2, step.description, -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt, 3, applied_time.c_str(), -1, SQLITE_STATIC);
+            ok = sqlite3_step(stmt) == SQLITE_DONE;
+            sqlite3_reset(stmt);
+        } else {
+            ok = false;
+        }
+        if (!ok || !execute_sql(db, "COMMIT;")) {
+            std::cerr << "数据库迁移到版本 " << step.version << " 失败" << std::endl;
+            execute_sql(db, "ROLLBACK;");
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Database::backfill_changes() {
+    DbConnection& db = *writer;
+    sqlite3_stmt* stmt;
+    if (db.prepare("SELECT 1 FROM changes LIMIT 1;", &stmt) != SQLITE_OK) {
+        return false;
+    }
+    bool has_changes = sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_reset(stmt);
+    if (has_changes) {
+        return true;
+    }
     
-    return execute_sql(create_users_table) &&
-           execute_sql(create_messages_table) &&
-           execute_sql(create_groups_table) &&
-           execute_sql(create_group_members_table) &&
-           execute_sql(create_posts_table) &&
-           execute_sql(create_replies_table);
+    // 变更日志为空时为已有数据补记一次，游标为 0 的同步仍能取到升级前的数据
+    return execute_sql(db, R"(
+        INSERT INTO changes (kind, user_id)
+            SELECT 'contact', user_id FROM users ORDER BY user_id;
+        INSERT INTO changes (kind, user_id, group_id)
+            SELECT 'join', user_id, group_id FROM group_members ORDER BY member_id;
+        INSERT INTO changes (kind, user_id, receiver_id, group_id, message_id)
+            SELECT 'message', sender_id, receiver_id, group_id, message_id FROM messages ORDER BY message_id;
+    )");
 }
 
-bool Database::execute_sql(const std::string& sql) {
+bool Database::execute_sql(sqlite3* db, const std::string& sql) {
     if (!db) {
         std::cerr << "数据库连接未初始化" << std::endl;
         return false;
@@ -119,8 +581,8 @@ bool Database::execute_sql(const std::string& sql) {
     return true;
 }
 
-bool Database::create_user(const std::string& username, const std::string& password) {
-    std::lock_guard<std::mutex> lock(db_mutex);
+bool Database::create_user(const std::string& username, const std::string& password, int& user_id) {
+    WriteLease db(*this);
     if (!db) {
         std::cerr << "数据库连接未初始化" << std::endl;
         return false;
@@ -136,7 +598,7 @@ bool Database::create_user(const std::string& username, const std::string& passw
     std::string sql = "INSERT INTO users (username, password) VALUES (?, ?);";
     
     sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    if (db.prepare(sql, &stmt) != SQLITE_OK) {
         return false;
     }
     
@@ -144,12 +606,16 @@ bool Database::create_user(const std::string& username, const std::string& passw
     sqlite3_bind_text(stmt, 2, hashed_password.c_str(), -1, SQLITE_STATIC);
     
     int rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
-    
-    return rc == SQLITE_DONE;
+    sqlite3_reset(stmt);
+    if (rc != SQLITE_DONE) {
+        return false;
+    }
+    user_id = static_cast<int>(sqlite3_last_insert_rowid(db));
+    return true;
 }
 
 bool Database::user_exists(const std::string& username) {
+    ReadLease db(*this);
     if (!db) {
         std::cerr << "数据库连接未初始化" << std::endl;
         return false;
@@ -158,29 +624,28 @@ bool Database::user_exists(const std::string& username) {
     std::string sql = "SELECT user_id FROM users WHERE username = ?;";
     
     sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    if (db.prepare(sql, &stmt) != SQLITE_OK) {
         return false;
     }
     
     sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_STATIC);
     
     bool exists = (sqlite3_step(stmt) == SQLITE_ROW);
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     
     return exists;
 }
 
 bool Database::verify_user(const std::string& username, const std::string& password, User& user) {
+    ReadLease db(*this);
     if (!db) {
         std::cerr << "数据库连接未初始化" << std::endl;
         return false;
     }
     
     // 先根据用户名查询用户
-    std::string sql = "SELECT user_id, username, password FROM users WHERE username = ?;";
-    
     sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    if (db.prepare(USER_BY_NAME_SQL, &stmt) != SQLITE_OK) {
         return false;
     }
     
@@ -190,7 +655,7 @@ bool Database::verify_user(const std::string& username, const std::string& passw
         user.user_id = sqlite3_column_int(stmt, 0);
         user.username = safe_sqlite3_text(stmt, 1);
         std::string stored_hash = safe_sqlite3_text(stmt, 2);
-        sqlite3_finalize(stmt);
+        sqlite3_reset(stmt);
         
         // 验证密码
         if (verify_password(password, stored_hash)) {
@@ -198,18 +663,132 @@ bool Database::verify_user(const std::string& username, const std::string& passw
             return true;
         }
     } else {
-        sqlite3_finalize(stmt);
+        sqlite3_reset(stmt);
     }
     
     return false;
 }
 
-bool Database::save_message(const Message& message) {
-    std::lock_guard<std::mutex> lock(db_mutex);
+bool Database::backfill_conversations() {
+    DbConnection& db = *writer;
+    sqlite3_stmt* stmt;
+    if (db.prepare("SELECT 1 FROM conversations LIMIT 1;", &stmt) != SQLITE_OK) {
+        return false;
+    }
+    bool has_conversations = sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_reset(stmt);
+    if (has_conversations) {
+        return true;
+    }
+    
+    // 从已有消息生成会话列表，升级前的消息视为已读
+    return execute_sql(db, R"(
+        INSERT INTO conversations (user_id, peer_id, group_id, last_message_id, last_sender_id, preview, last_timestamp)
+            SELECT x.user_id, x.peer_id, -1, m.message_id, m.sender_id, substr(m.content, 1, 64), m.timestamp
+            FROM (SELECT user_id, peer_id, MAX(message_id) AS message_id FROM (
+                      SELECT sender_id AS user_id, receiver_id AS peer_id, message_id FROM messages WHERE group_id IS NULL
+                      UNION ALL
+                      SELECT receiver_id, sender_id, message_id FROM messages WHERE group_id IS NULL)
+                  GROUP BY user_id, peer_id) x
+            JOIN messages m ON m.message_id = x.message_id;
+        INSERT INTO conversations (user_id, peer_id, group_id, last_message_id, last_sender_id, preview, last_timestamp)
+            SELECT x.user_id, -1, x.group_id, m.message_id, m.sender_id, substr(m.content, 1, 64), m.timestamp
+            FROM (SELECT gm.user_id, gm.group_id, MAX(msg.message_id) AS message_id
+                  FROM group_members gm JOIN messages msg ON msg.group_id = gm.group_id
+                  GROUP BY gm.user_id, gm.group_id) x
+            JOIN messages m ON m.message_id = x.message_id;
+    )");
+}
+
+bool Database::save_message(Message& message) {
+    std::future<int> done;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        if (stopping || !message_writer.joinable()) {
+            return false;
+        }
+        pending_messages.push_back(PendingMessage{message, std::promise<int>()});
+        done = pending_messages.back().done.get_future();
+    }
+    pending_ready.notify_one();
+    
+    // 事务提交之后才返回，调用方确认发送成功时消息已经落盘
+    int message_id = done.get();
+    if (message_id == -1) {
+        return false;
+    }
+    message.message_id = message_id;
+    return true;
+}
+
+void Database::run_message_writer() {
+    std::vector<PendingMessage> batch;
+    size_t last_batch = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(pending_mutex);
+            pending_ready.wait(lock, [this]() { return stopping || !pending_messages.empty(); });
+            if (pending_messages.empty()) {
+                break;
+            }
+            // 上一批不止一条说明有并发发送，最多再等一个窗口，攒到和上一批一样多或达到上限就提交；
+            // 空闲时直接提交，单条消息不为等待窗口增加延迟
+            if (batch_config.window_ms > 0 && last_batch > 1) {
+                size_t target = std::min(last_batch, static_cast<size_t>(batch_config.max_rows));
+                pending_ready.wait_for(lock, std::chrono::milliseconds(batch_config.window_ms), [&]() {
+                    return stopping || pending_messages.size() >= target;
+                });
+            }
+            size_t count = std::min(pending_messages.size(), static_cast<size_t>(batch_config.max_rows));
+            for (size_t i = 0; i < count; ++i) {
+                batch.push_back(std::move(pending_messages.front()));
+                pending_messages.pop_front();
+            }
+        }
+        write_batch(batch);
+        last_batch = batch.size();
+        batch.clear();
+    }
+}
+
+void Database::write_batch(std::vector<PendingMessage>& batch) {
+    std::vector<int> message_ids(batch.size(), -1);
+    {
+        WriteLease db(*this);
+        // 消息和会话列表在同一事务中写入
+        bool committed = false;
+        if (execute_sql(db, "BEGIN IMMEDIATE;")) {
+            for (size_t i = 0; i < batch.size(); ++i) {
+                // 每条消息一个保存点，写入失败只回滚这一条
+                Message& message = batch[i].message;
+                execute_sql(db, "SAVEPOINT message;");
+                if (insert_message(db, message) && update_conversations(db, message)) {
+                    message_ids[i] = message.message_id;
+                    execute_sql(db, "RELEASE message;");
+                } else {
+                    execute_sql(db, "ROLLBACK TO message; RELEASE message;");
+                }
+            }
+            committed = execute_sql(db, "COMMIT;");
+            if (!committed) {
+                execute_sql(db, "ROLLBACK;");
+            }
+        }
+        if (!committed) {
+            std::fill(message_ids.begin(), message_ids.end(), -1);
+        }
+    }
+    
+    for (size_t i = 0; i < batch.size(); ++i) {
+        batch[i].done.set_value(message_ids[i]);
+    }
+}
+
+bool Database::insert_message(DbConnection& db, Message& message) {
     std::string sql = "INSERT INTO messages (sender_id, receiver_id, group_id, content, type, timestamp) VALUES (?, ?, ?, ?, ?, ?);";
     
     sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    if (db.prepare(sql, &stmt) != SQLITE_OK) {
         return false;
     }
     
@@ -231,47 +810,89 @@ bool Database::save_message(const Message& message) {
     sqlite3_bind_text(stmt, 6, message.timestamp.c_str(), -1, SQLITE_STATIC);
     
     int rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     
-    return rc == SQLITE_DONE;
+    if (rc != SQLITE_DONE) {
+        return false;
+    }
+    message.message_id = static_cast<int>(sqlite3_last_insert_rowid(db));
+    return true;
+}
+
+bool Database::update_conversations(DbConnection& db, const Message& message) {
+    static const char* upsert = R"(
+        ON CONFLICT (user_id, peer_id, group_id) DO UPDATE SET
+            last_message_id = excluded.last_message_id,
+            last_sender_id = excluded.last_sender_id,
+            preview = excluded.preview,
+            last_timestamp = excluded.last_timestamp,
+            unread_count = unread_count + excluded.unread_count;
+    )";
+    
+    std::string sql;
+    if (message.group_id == -1) {
+        sql = std::string("INSERT INTO conversations (user_id, peer_id, group_id, last_message_id, last_sender_id, "
+                          "preview, last_timestamp, unread_count) "
+                          "VALUES (?1, ?2, -1, ?3, ?4, substr(?5, 1, 64), ?6, ?7) ") + upsert;
+    } else {
+        // 群消息更新每个成员的会话行，发送者自己不计未读
+        sql = std::string("INSERT INTO conversations (user_id, peer_id, group_id, last_message_id, last_sender_id, "
+                          "preview, last_timestamp, unread_count) "
+                          "SELECT user_id, -1, ?2, ?3, ?4, substr(?5, 1, 64), ?6, user_id != ?4 "
+                          "FROM group_members WHERE group_id = ?2 ") + upsert;
+    }
+    
+    sqlite3_stmt* stmt;
+    if (db.prepare(sql, &stmt) != SQLITE_OK) {
+        return false;
+    }
+    
+    sqlite3_bind_int(stmt, 3, message.message_id);
+    sqlite3_bind_int(stmt, 4, message.sender_id);
+    sqlite3_bind_text(stmt, 5, message.content.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 6, message.timestamp.c_str(), -1, SQLITE_STATIC);
+    
+    bool ok;
+    if (message.group_id != -1) {
+        sqlite3_bind_int(stmt, 2, message.group_id);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+    } else {
+        // 发送者一行不计未读，接收者一行未读数加一（给自己发消息时只更新一行）
+        auto upsert_row = [&](int user_id, int peer_id, int unread) {
+            sqlite3_reset(stmt);
+            sqlite3_bind_int(stmt, 1, user_id);
+            sqlite3_bind_int(stmt, 2, peer_id);
+            sqlite3_bind_int(stmt, 7, unread);
+            return sqlite3_step(stmt) == SQLITE_DONE;
+        };
+        ok = upsert_row(message.sender_id, message.receiver_id, 0);
+        if (ok && message.receiver_id != message.sender_id) {
+            ok = upsert_row(message.receiver_id, message.sender_id, 1);
+        }
+    }
+    
+    sqlite3_reset(stmt);
+    return ok;
 }
 
 std::vector<Message> Database::get_messages(int user_id, int limit, int before_id) {
-    std::lock_guard<std::mutex> lock(db_mutex);
+    ReadLease db(*this);
     std::vector<Message> messages;
-    std::string sql;
     
     if (!db) {
         std::cerr << "数据库连接未初始化" << std::endl;
         return messages;
     }
     
-    if (before_id > 0) {
-        // 获取指定消息ID之前的消息（用于无限滚动加载）
-        sql = "SELECT message_id, sender_id, receiver_id, group_id, content, type, timestamp "
-              "FROM messages WHERE (sender_id = ? OR receiver_id = ?) AND message_id < ? "
-              "ORDER BY message_id DESC LIMIT ?;";
-    } else {
-        // 获取最新的消息
-        sql = "SELECT message_id, sender_id, receiver_id, group_id, content, type, timestamp "
-              "FROM messages WHERE sender_id = ? OR receiver_id = ? "
-              "ORDER BY message_id DESC LIMIT ?;";
-    }
-    
     sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    if (db.prepare(USER_MESSAGES_SQL, &stmt) != SQLITE_OK) {
         return messages;
     }
     
+    // 不带 before_id 时获取最新的消息，否则获取指定消息ID之前的消息（用于无限滚动加载）
     sqlite3_bind_int(stmt, 1, user_id);
-    sqlite3_bind_int(stmt, 2, user_id);
-    
-    if (before_id > 0) {
-        sqlite3_bind_int(stmt, 3, before_id);
-        sqlite3_bind_int(stmt, 4, limit);
-    } else {
-        sqlite3_bind_int(stmt, 3, limit);
-    }
+    sqlite3_bind_int(stmt, 2, before_id > 0 ? before_id : INT32_MAX);
+    sqlite3_bind_int(stmt, 3, limit);
     
     while (sqlite3_step(stmt) == SQLITE_ROW) {
         Message message;
@@ -293,11 +914,12 @@ std::vector<Message> Database::get_messages(int user_id, int limit, int before_i
         message.content = safe_sqlite3_text(stmt, 4);
         message.type = safe_sqlite3_text(stmt, 5);
         message.timestamp = safe_sqlite3_text(stmt, 6);
+        message.sender_username = safe_sqlite3_text(stmt, 7);
         
         messages.push_back(message);
     }
     
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     
     // 反转顺序，使消息按时间正序排列
     std::reverse(messages.begin(), messages.end());
@@ -309,7 +931,59 @@ std::vector<Message> Database::get_messages_before(int user_id, int before_id, i
     return get_messages(user_id, limit, before_id);
 }
 
+std::vector<Message> Database::get_messages_since(int user_id, int since_id, int limit) {
+    ReadLease db(*this);
+    std::vector<Message> messages;
+    
+    if (!db) {
+        std::cerr << "数据库连接未初始化" << std::endl;
+        return messages;
+    }
+    
+    sqlite3_stmt* stmt;
+    if (db.prepare(MESSAGES_SINCE_SQL, &stmt) != SQLITE_OK) {
+        return messages;
+    }
+    
+    sqlite3_bind_int(stmt, 1, since_id);
+    sqlite3_bind_int(stmt, 2, user_id);
+    sqlite3_bind_int(stmt, 3, limit);
+    
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        Message message;
+        message.message_id = sqlite3_column_int(stmt, 0);
+        message.sender_id = sqlite3_column_int(stmt, 1);
+        message.receiver_id = sqlite3_column_type(stmt, 2) == SQLITE_NULL ? -1 : sqlite3_column_int(stmt, 2);
+        message.group_id = sqlite3_column_type(stmt, 3) == SQLITE_NULL ? -1 : sqlite3_column_int(stmt, 3);
+        message.content = safe_sqlite3_text(stmt, 4);
+        message.type = safe_sqlite3_text(stmt, 5);
+        message.timestamp = safe_sqlite3_text(stmt, 6);
+        message.sender_username = safe_sqlite3_text(stmt, 7);
+        messages.push_back(message);
+    }
+    
+    sqlite3_reset(stmt);
+    return messages;
+}
+
+int Database::get_latest_message_id() {
+    ReadLease db(*this);
+    if (!db) {
+        std::cerr << "数据库连接未初始化" << std::endl;
+        return 0;
+    }
+    
+    sqlite3_stmt* stmt;
+    if (db.prepare("SELECT COALESCE(MAX(message_id), 0) FROM messages;", &stmt) != SQLITE_OK) {
+        return 0;
+    }
+    int message_id = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : 0;
+    sqlite3_reset(stmt);
+    return message_id;
+}
+
 std::vector<User> Database::get_user_contacts(int user_id) {
+    ReadLease db(*this);
     std::vector<User> contacts;
     
     // 获取所有用户（除了当前用户自己）
@@ -321,7 +995,7 @@ std::vector<User> Database::get_user_contacts(int user_id) {
     )";
     
     sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    if (db.prepare(sql, &stmt) != SQLITE_OK) {
         return contacts;
     }
     
@@ -339,16 +1013,169 @@ std::vector<User> Database::get_user_contacts(int user_id) {
         contacts.push_back(contact);
     }
     
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return contacts;
 }
 
+SyncChanges Database::get_changes_since(int user_id, int cursor, int limit) {
+    ReadLease db(*this);
+    SyncChanges changes;
+    changes.cursor = cursor;
+    changes.has_more = false;
+    
+    if (!db) {
+        std::cerr << "数据库连接未初始化" << std::endl;
+        return changes;
+    }
+    
+    // 先取当前最大序号作为上界：没有更多变更时游标直接前进到这里，
+    // 同步期间新写入的变更留给下一次同步
+    sqlite3_stmt* stmt;
+    if (db.prepare("SELECT COALESCE(MAX(seq), 0) FROM changes;", &stmt) != SQLITE_OK) {
+        return changes;
+    }
+    int max_seq = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : cursor;
+    sqlite3_reset(stmt);
+    if (max_seq <= cursor) {
+        return changes;
+    }
+    
+    if (db.prepare(CHANGES_SINCE_SQL, &stmt) != SQLITE_OK) {
+        return changes;
+    }
+    
+    sqlite3_bind_int(stmt, 1, cursor);
+    sqlite3_bind_int(stmt, 2, max_seq);
+    sqlite3_bind_int(stmt, 3, user_id);
+    sqlite3_bind_int(stmt, 4, limit);
+    
+    int rows = 0;
+    int last_seq = cursor;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        ++rows;
+        last_seq = sqlite3_column_int(stmt, 0);
+        std::string kind = safe_sqlite3_text(stmt, 1);
+        int group_id = sqlite3_column_int(stmt, 3);
+        
+        if (kind == "message") {
+            if (sqlite3_column_type(stmt, 4) == SQLITE_NULL) {
+                continue;
+            }
+            Message message;
+            message.message_id = sqlite3_column_int(stmt, 4);
+            message.sender_id = sqlite3_column_int(stmt, 5);
+            message.receiver_id = sqlite3_column_type(stmt, 6) == SQLITE_NULL ? -1 : sqlite3_column_int(stmt, 6);
+            message.group_id = sqlite3_column_type(stmt, 7) == SQLITE_NULL ? -1 : sqlite3_column_int(stmt, 7);
+            message.content = safe_sqlite3_text(stmt, 8);
+            message.type = safe_sqlite3_text(stmt, 9);
+            message.timestamp = safe_sqlite3_text(stmt, 10);
+            message.sender_username = safe_sqlite3_text(stmt, 11);
+            changes.messages.push_back(std::move(message));
+        } else if (kind == "join" || kind == "leave") {
+            // 同一群组多次加入、退出只保留最后的状态
+            auto& joined = changes.groups_joined;
+            auto& left = changes.groups_left;
+            joined.erase(std::remove_if(joined.begin(), joined.end(),
+                                        [group_id](const Group& g) { return g.group_id == group_id; }),
+                         joined.end());
+            left.erase(std::remove(left.begin(), left.end(), group_id), left.end());
+            if (kind == "leave") {
+                left.push_back(group_id);
+            } else if (sqlite3_column_type(stmt, 12) != SQLITE_NULL) {
+                Group group;
+                group.group_id = group_id;
+                group.group_name = safe_sqlite3_text(stmt, 12);
+                group.description = safe_sqlite3_text(stmt, 13);
+                group.creator_id = sqlite3_column_int(stmt, 14);
+                group.created_time = safe_sqlite3_text(stmt, 15);
+                joined.push_back(std::move(group));
+            }
+        } else if (kind == "contact") {
+            User contact;
+            contact.user_id = sqlite3_column_int(stmt, 2);
+            contact.username = safe_sqlite3_text(stmt, 16);
+            contact.online = false;
+            contact.socket_fd = -1;
+            changes.contacts.push_back(std::move(contact));
+        }
+    }
+    
+    sqlite3_reset(stmt);
+    
+    changes.has_more = rows >= limit;
+    changes.cursor = changes.has_more ? last_seq : max_seq;
+    return changes;
+}
+
+std::vector<Conversation> Database::get_conversations(int user_id, int before_id, int limit) {
+    ReadLease db(*this);
+    std::vector<Conversation> conversations;
+    
+    if (!db) {
+        std::cerr << "数据库连接未初始化" << std::endl;
+        return conversations;
+    }
+    
+    sqlite3_stmt* stmt;
+    if (db.prepare(CONVERSATIONS_SQL, &stmt) != SQLITE_OK) {
+        return conversations;
+    }
+    
+    sqlite3_bind_int(stmt, 1, user_id);
+    sqlite3_bind_int(stmt, 2, before_id > 0 ? before_id : INT32_MAX);
+    sqlite3_bind_int(stmt, 3, limit);
+    
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        Conversation conversation;
+        conversation.peer_id = sqlite3_column_int(stmt, 0);
+        conversation.peer_username = safe_sqlite3_text(stmt, 1);
+        conversation.group_id = sqlite3_column_int(stmt, 2);
+        conversation.group_name = safe_sqlite3_text(stmt, 3);
+        conversation.last_message_id = sqlite3_column_int(stmt, 4);
+        conversation.last_sender_id = sqlite3_column_int(stmt, 5);
+        conversation.preview = safe_sqlite3_text(stmt, 6);
+        conversation.last_timestamp = safe_sqlite3_text(stmt, 7);
+        conversation.unread_count = sqlite3_column_int(stmt, 8);
+        conversations.push_back(std::move(conversation));
+    }
+    
+    sqlite3_reset(stmt);
+    return conversations;
+}
+
+bool Database::mark_conversation_read(int user_id, int peer_id, int group_id, int up_to_id) {
+    WriteLease db(*this);
+    if (!db) {
+        std::cerr << "数据库连接未初始化" << std::endl;
+        return false;
+    }
+    
+    // 客户端读到 up_to_id 之后又有新消息时保留未读数，避免把未看到的消息标为已读
+    std::string sql = "UPDATE conversations SET unread_count = 0 "
+                      "WHERE user_id = ? AND peer_id = ? AND group_id = ? AND last_message_id <= ?;";
+    
+    sqlite3_stmt* stmt;
+    if (db.prepare(sql, &stmt) != SQLITE_OK) {
+        return false;
+    }
+    
+    sqlite3_bind_int(stmt, 1, user_id);
+    sqlite3_bind_int(stmt, 2, peer_id);
+    sqlite3_bind_int(stmt, 3, group_id);
+    sqlite3_bind_int(stmt, 4, up_to_id > 0 ? up_to_id : INT32_MAX);
+    
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    
+    return rc == SQLITE_DONE;
+}
+
 bool Database::create_post(const Post& post) {
-    std::lock_guard<std::mutex> lock(db_mutex);
+    WriteLease db(*this);
     std::string sql = "INSERT INTO posts (user_id, title, content, timestamp) VALUES (?, ?, ?, ?);";
     
     sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    if (db.prepare(sql, &stmt) != SQLITE_OK) {
         return false;
     }
     
@@ -358,12 +1185,12 @@ bool Database::create_post(const Post& post) {
     sqlite3_bind_text(stmt, 4, post.timestamp.c_str(), -1, SQLITE_STATIC);
     
     int rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     
     return rc == SQLITE_DONE;
 }
 std::vector<Post> Database::get_posts(int page, int page_size) {
-    std::lock_guard<std::mutex> lock(db_mutex);
+    ReadLease db(*this);
     std::vector<Post> posts;
     
     if (!db) {
@@ -375,29 +1202,19 @@ std::vector<Post> Database::get_posts(int page, int page_size) {
     int offset = (page - 1) * page_size;
     if (offset < 0) offset = 0;
     
-    std::string sql = "SELECT post_id, user_id, title, content, timestamp FROM posts "
-                      "ORDER BY post_id DESC LIMIT ? OFFSET ?;";
+    // 偏移量越大，SQLite 需要逐行跳过的帖子越多；深翻页应使用 get_posts_before
+    std::string sql = "SELECT p.post_id, p.user_id, p.title, p.content, p.timestamp, u.username "
+                      "FROM posts p LEFT JOIN users u ON u.user_id = p.user_id "
+                      "ORDER BY p.post_id DESC LIMIT ? OFFSET ?;";
     
     sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    if (db.prepare(sql, &stmt) != SQLITE_OK) {
         return posts;
     }
     
     sqlite3_bind_int(stmt, 1, page_size);
     sqlite3_bind_int(stmt, 2, offset);
-    
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        Post post;
-        post.post_id = sqlite3_column_int(stmt, 0);
-        post.user_id = sqlite3_column_int(stmt, 1);
-        post.title = safe_sqlite3_text(stmt, 2);
-        post.content = safe_sqlite3_text(stmt, 3);
-        post.timestamp = safe_sqlite3_text(stmt, 4);
-        
-        posts.push_back(post);
-    }
-    
-    sqlite3_finalize(stmt);
+    read_posts(stmt, posts);
     return posts;
 }
 
@@ -405,11 +1222,37 @@ std::vector<Post> Database::get_posts_page(int page, int page_size) {
     return get_posts(page, page_size);
 }
 
+std::vector<Post> Database::get_posts_before(int before_id, int limit) {
+    ReadLease db(*this);
+    std::vector<Post> posts;
+    
+    if (!db) {
+        std::cerr << "数据库连接未初始化" << std::endl;
+        return posts;
+    }
+    
+    // 按主键定位到 before_id 后倒序取 limit 行，与翻到第几页无关
+    std::string sql = "SELECT p.post_id, p.user_id, p.title, p.content, p.timestamp, u.username "
+                      "FROM posts p LEFT JOIN users u ON u.user_id = p.user_id "
+                      "WHERE p.post_id < ? ORDER BY p.post_id DESC LIMIT ?;";
+    
+    sqlite3_stmt* stmt;
+    if (db.prepare(sql, &stmt) != SQLITE_OK) {
+        return posts;
+    }
+    
+    sqlite3_bind_int(stmt, 1, before_id > 0 ? before_id : INT32_MAX);
+    sqlite3_bind_int(stmt, 2, limit);
+    read_posts(stmt, posts);
+    return posts;
+}
+
 bool Database::reply_post(int post_id, int user_id, const std::string& content, const std::string& timestamp) {
+    WriteLease db(*this);
     std::string sql = "INSERT INTO replies (post_id, user_id, content, timestamp) VALUES (?, ?, ?, ?);";
     
     sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    if (db.prepare(sql, &stmt) != SQLITE_OK) {
         return false;
     }
     
@@ -419,17 +1262,16 @@ bool Database::reply_post(int post_id, int user_id, const std::string& content,
     sqlite3_bind_text(stmt, 4, timestamp.c_str(), -1, SQLITE_STATIC);
     
     int rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     
     return rc == SQLITE_DONE;
 }
 
 std::vector<Reply> Database::get_post_replies(int post_id) {
+    ReadLease db(*this);
     std::vector<Reply> replies;
-    std::string sql = "SELECT reply_id, post_id, user_id, content, timestamp FROM replies WHERE post_id = ? ORDER BY timestamp;";
-    
     sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    if (db.prepare(POST_REPLIES_SQL, &stmt) != SQLITE_OK) {
         return replies;
     }
     
@@ -442,47 +1284,32 @@ std::vector<Reply> Database::get_post_replies(int post_id) {
         reply.user_id = sqlite3_column_int(stmt, 2);
         reply.content = safe_sqlite3_text(stmt, 3);
         reply.timestamp = safe_sqlite3_text(stmt, 4);
+        reply.username = safe_sqlite3_text(stmt, 5);
         replies.push_back(reply);
     }
     
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return replies;
 }
 
 std::vector<Message> Database::get_group_messages(int group_id, int limit, int before_id) {
+    ReadLease db(*this);
     std::vector<Message> messages;
-    std::string sql;
     
     if (!db) {
         std::cerr << "数据库连接未初始化" << std::endl;
         return messages;
     }
     
-    if (before_id > 0) {
-        // 获取指定消息ID之前的消息（用于无限滚动加载）
-        sql = "SELECT message_id, sender_id, receiver_id, group_id, content, type, timestamp "
-              "FROM messages WHERE group_id = ? AND message_id < ? "
-              "ORDER BY message_id DESC LIMIT ?;";
-    } else {
-        // 获取最新的消息
-        sql = "SELECT message_id, sender_id, receiver_id, group_id, content, type, timestamp "
-              "FROM messages WHERE group_id = ? "
-              "ORDER BY message_id DESC LIMIT ?;";
-    }
-    
     sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    if (db.prepare(GROUP_MESSAGES_SQL, &stmt) != SQLITE_OK) {
         return messages;
     }
     
+    // 不带 before_id 时获取最新的消息，否则获取指定消息ID之前的消息（用于无限滚动加载）
     sqlite3_bind_int(stmt, 1, group_id);
-    
-    if (before_id > 0) {
-        sqlite3_bind_int(stmt, 2, before_id);
-        sqlite3_bind_int(stmt, 3, limit);
-    } else {
-        sqlite3_bind_int(stmt, 2, limit);
-    }
+    sqlite3_bind_int(stmt, 2, before_id > 0 ? before_id : INT32_MAX);
+    sqlite3_bind_int(stmt, 3, limit);
     
     while (sqlite3_step(stmt) == SQLITE_ROW) {
         Message message;
@@ -499,11 +1326,12 @@ std::vector<Message> Database::get_group_messages(int group_id, int limit, int b
         message.content = safe_sqlite3_text(stmt, 4);
         message.type = safe_sqlite3_text(stmt, 5);
         message.timestamp = safe_sqlite3_text(stmt, 6);
+        message.sender_username = safe_sqlite3_text(stmt, 7);
         
         messages.push_back(message);
     }
     
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     
     // 反转顺序，使消息按时间正序排列
     std::reverse(messages.begin(), messages.end());
@@ -515,11 +1343,12 @@ std::vector<Message> Database::get_group_messages_before(int group_id, int befor
     return get_group_messages(group_id, limit, before_id);
 }
 
-bool Database::create_group(const Group& group) {
+bool Database::create_group(Group& group) {
+    WriteLease db(*this);
     std::string sql = "INSERT INTO groups (group_name, description, creator_id, created_time) VALUES (?, ?, ?, ?);";
     
     sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    if (db.prepare(sql, &stmt) != SQLITE_OK) {
         return false;
     }
     
@@ -529,23 +1358,24 @@ bool Database::create_group(const Group& group) {
     sqlite3_bind_text(stmt, 4, group.created_time.c_str(), -1, SQLITE_STATIC);
     
     int rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     
     if (rc == SQLITE_DONE) {
         // 自动让创建者加入群组
-        int group_id = sqlite3_last_insert_rowid(db);
-        return join_group(group.creator_id, group_id);
+        group.group_id = sqlite3_last_insert_rowid(db);
+        return add_group_member(db, group.creator_id, group.group_id);
     }
     
     return false;
 }
 
 std::vector<Group> Database::get_all_groups() {
+    ReadLease db(*this);
     std::vector<Group> groups;
     std::string sql = "SELECT group_id, group_name, description, creator_id, created_time FROM groups ORDER BY created_time;";
     
     sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    if (db.prepare(sql, &stmt) != SQLITE_OK) {
         return groups;
     }
     
@@ -560,22 +1390,15 @@ std::vector<Group> Database::get_all_groups() {
         groups.push_back(group);
     }
     
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return groups;
 }
 
 std::vector<Group> Database::get_user_groups(int user_id) {
+    ReadLease db(*this);
     std::vector<Group> groups;
-    std::string sql = R"(
-        SELECT g.group_id, g.group_name, g.description, g.creator_id, g.created_time 
-        FROM groups g 
-        INNER JOIN group_members gm ON g.group_id = gm.group_id 
-        WHERE gm.user_id = ? 
-        ORDER BY g.created_time;
-    )";
-    
     sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    if (db.prepare(USER_GROUPS_SQL, &stmt) != SQLITE_OK) {
         return groups;
     }
     
@@ -592,15 +1415,20 @@ std::vector<Group> Database::get_user_groups(int user_id) {
         groups.push_back(group);
     }
     
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return groups;
 }
 
 bool Database::join_group(int user_id, int group_id) {
+    WriteLease db(*this);
+    return add_group_member(db, user_id, group_id);
+}
+
+bool Database::add_group_member(DbConnection& db, int user_id, int group_id) {
     std::string sql = "INSERT INTO group_members (group_id, user_id, joined_time) VALUES (?, ?, datetime('now'));";
     
     sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    if (db.prepare(sql, &stmt) != SQLITE_OK) {
         return false;
     }
     
@@ -608,33 +1436,50 @@ bool Database::join_group(int user_id, int group_id) {
     sqlite3_bind_int(stmt, 2, user_id);
     
     int rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     
     return rc == SQLITE_DONE;
 }
 
 bool Database::leave_group(int user_id, int group_id) {
-    std::string sql = "DELETE FROM group_members WHERE group_id = ? AND user_id = ?;";
-    
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    WriteLease db(*this);
+    // 删除成员（触发器同时写入 changes 的 leave 记录）和删除会话列表项在同一事务中提交，
+    // 增量同步看到的成员变化与 group_members 保持一致
+    if (!execute_sql(db, "BEGIN IMMEDIATE;")) {
         return false;
     }
     
-    sqlite3_bind_int(stmt, 1, group_id);
-    sqlite3_bind_int(stmt, 2, user_id);
+    sqlite3_stmt* stmt;
+    bool ok = db.prepare("DELETE FROM group_members WHERE group_id = ? AND user_id = ?;", &stmt) == SQLITE_OK;
+    if (ok) {
+        sqlite3_bind_int(stmt, 1, group_id);
+        sqlite3_bind_int(stmt, 2, user_id);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_reset(stmt);
+    }
     
-    int rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    // 退出群组后该群不再出现在会话列表中
+    if (ok && db.prepare("DELETE FROM conversations WHERE user_id = ? AND peer_id = -1 AND group_id = ?;",
+                         &stmt) == SQLITE_OK) {
+        sqlite3_bind_int(stmt, 1, user_id);
+        sqlite3_bind_int(stmt, 2, group_id);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_reset(stmt);
+    } else {
+        ok = false;
+    }
     
-    return rc == SQLITE_DONE;
+    if (!ok || !execute_sql(db, "COMMIT;")) {
+        execute_sql(db, "ROLLBACK;");
+        return false;
+    }
+    return true;
 }
 
 bool Database::is_user_in_group(int user_id, int group_id) {
-    std::string sql = "SELECT 1 FROM group_members WHERE group_id = ? AND user_id = ?;";
-    
+    ReadLease db(*this);
     sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    if (db.prepare(GROUP_MEMBER_SQL, &stmt) != SQLITE_OK) {
         return false;
     }
     
@@ -642,17 +1487,38 @@ bool Database::is_user_in_group(int user_id, int group_id) {
     sqlite3_bind_int(stmt, 2, user_id);
     
     bool exists = (sqlite3_step(stmt) == SQLITE_ROW);
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     
     return exists;
 }
 
+// 按用户ID顺序遍历全部用户，用于启动时载入用户目录
+void Database::for_each_user(const std::function<void(int user_id, std::string_view username)>& callback) {
+    ReadLease db(*this);
+    if (!db) {
+        std::cerr << "数据库连接未初始化" << std::endl;
+        return;
+    }
+    
+    sqlite3_stmt* stmt;
+    if (db.prepare("SELECT user_id, username FROM users ORDER BY user_id;", &stmt) != SQLITE_OK) {
+        return;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* username = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        int length = sqlite3_column_bytes(stmt, 1);
+        callback(sqlite3_column_int(stmt, 0), std::string_view(username ? username : "", length));
+    }
+    sqlite3_reset(stmt);
+}
+
 // 新增：通过用户ID获取用户名
 std::string Database::get_username_by_id(int user_id) {
+    ReadLease db(*this);
     std::string sql = "SELECT username FROM users WHERE user_id = ?;";
     
     sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    if (db.prepare(sql, &stmt) != SQLITE_OK) {
         return "";
     }
     
@@ -660,22 +1526,23 @@ std::string Database::get_username_by_id(int user_id) {
     
     if (sqlite3_step(stmt) == SQLITE_ROW) {
         std::string username = safe_sqlite3_text(stmt, 0);
-        sqlite3_finalize(stmt);
+        sqlite3_reset(stmt);
         return username;
     }
     
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return "";
 }
 
 // 新增：通过帖子ID获取帖子详情
 Post Database::get_post_by_id(int post_id) {
+    ReadLease db(*this);
     Post post;
     std::string sql = "SELECT p.post_id, p.user_id, u.username, p.title, p.content, p.timestamp "
                      "FROM posts p JOIN users u ON p.user_id = u.user_id WHERE p.post_id = ?;";
     
     sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    if (db.prepare(sql, &stmt) != SQLITE_OK) {
         return post;
     }
     
@@ -690,6 +1557,6 @@ Post Database::get_post_by_id(int post_id) {
         post.timestamp = safe_sqlite3_text(stmt, 5);
     }
     
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return post;
 }
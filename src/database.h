@@ -5,30 +5,69 @@
 #include <string>
 #include <vector>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <deque>
+#include <functional>
+#include <future>
+#include <thread>
 #include "common.h"
 
+// 消息写入的批量提交参数
+struct WriteBatchConfig {
+    int max_rows = 128;  // 一个事务最多写入的消息数
+    int window_ms = 2;   // 第一条消息到达后等待更多消息的毫秒数，0 表示只合并已在排队的消息
+};
+
+// 预编译语句缓存统计（所有连接合计）
+struct StatementCacheStats {
+    uint64_t hits = 0;        // 直接复用已编译的语句
+    uint64_t misses = 0;      // 第一次使用时编译
+    uint64_t statements = 0;  // 缓存中的语句数
+};
+
+// 数据库访问：WAL 模式下一个写连接加一组读连接。
+// 每个操作从池中借出一个读连接或独占写连接，读查询在多个线程中并行，写操作串行。
+// 每个连接缓存自己编译过的语句，重复执行时只需重置并重新绑定参数。
+// 消息由专门的写线程批量写入：多条消息合并为一个事务，只需一次同步到磁盘
 class Database {
 public:
-    Database(const std::string& db_path);
+    // reader_count 为读连接数，0 表示按 CPU 核数
+    Database(const std::string& db_path, int reader_count = 0, WriteBatchConfig batch = WriteBatchConfig());
     ~Database();
     
-    bool create_user(const std::string& username, const std::string& password);
+    bool create_user(const std::string& username, const std::string& password, int& user_id);
     bool user_exists(const std::string& username);
     bool verify_user(const std::string& username, const std::string& password, User& user);
     
     // 新增：获取用户信息方法
     std::string get_username_by_id(int user_id);
+    // 按用户ID顺序遍历全部用户（启动时载入用户目录）
+    void for_each_user(const std::function<void(int user_id, std::string_view username)>& callback);
     Post get_post_by_id(int post_id);
     
-    bool save_message(const Message& message);
+    // 交给写线程并等待所在事务提交，成功时写回 message_id
+    bool save_message(Message& message);
     std::vector<Message> get_messages(int user_id, int limit = 50, int before_id = -1);
     std::vector<Message> get_messages_before(int user_id, int before_id, int limit = 50);
+    // 用户在 since_id 之后收到的私聊和所在群组的消息（不含自己发送的），按ID正序
+    std::vector<Message> get_messages_since(int user_id, int since_id, int limit = 100);
+    // 当前最大的消息ID，没有消息时为 0
+    int get_latest_message_id();
     std::vector<Message> get_group_messages(int group_id, int limit = 50, int before_id = -1);
     std::vector<Message> get_group_messages_before(int group_id, int before_id, int limit = 50);
     std::vector<User> get_user_contacts(int user_id);
+    // 会话列表：按最后一条消息倒序，before_id 为上一页最后一项的 last_message_id
+    std::vector<Conversation> get_conversations(int user_id, int before_id, int limit);
+    // 清零未读数；up_to_id > 0 时只在没有比它更新的消息时清零
+    bool mark_conversation_read(int user_id, int peer_id, int group_id, int up_to_id);
+    // 增量同步：cursor 之后与用户相关的消息、群组成员关系和联系人变更，最多读取 limit 条变更
+    SyncChanges get_changes_since(int user_id, int cursor, int limit = 500);
     
     // 群组管理
-    bool create_group(const Group& group);
+    bool create_group(Group& group);  // 成功时写回 group_id
     std::vector<Group> get_all_groups();
     std::vector<Group> get_user_groups(int user_id);
     bool join_group(int user_id, int group_id);
@@ -38,13 +77,102 @@ public:
     bool create_post(const Post& post);
     std::vector<Post> get_posts(int page = 1, int page_size = 20);
     std::vector<Post> get_posts_page(int page, int page_size);
+    // 帖子ID小于 before_id 的 limit 个帖子（按ID倒序），before_id <= 0 时从最新的帖子开始
+    std::vector<Post> get_posts_before(int before_id, int limit);
     bool reply_post(int post_id, int user_id, const std::string& content, const std::string& timestamp);
     std::vector<Reply> get_post_replies(int post_id);
+    
+    StatementCacheStats statement_cache_stats();
+    // 输出每条热点查询的执行计划，有任何一条需要全表扫描时返回 false
+    bool check_query_plans();
 private:
-    sqlite3* db;
-    mutable std::mutex db_mutex;
-    bool init_database();
-    bool execute_sql(const std::string& sql);
+    // 一个 SQLite 连接及其预编译语句缓存（以 SQL 文本为键），同一时间只被一个线程使用
+    class DbConnection {
+    public:
+        explicit DbConnection(sqlite3* handle);
+        ~DbConnection();
+        // 取出缓存的语句并重置、清除绑定，第一次使用时编译；语句归缓存所有，用完后只需 sqlite3_reset
+        int prepare(const std::string& sql, sqlite3_stmt** stmt);
+        // 重置本次借出期间用过的语句，释放它们占用的读事务
+        void reset_statements();
+        operator sqlite3*() const { return handle; }
+        
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+    private:
+        sqlite3* handle;
+        std::unordered_map<std::string, sqlite3_stmt*> statements;
+        std::vector<sqlite3_stmt*> in_use;
+    };
+
+    // 借出的读连接，析构时归还连接池
+    class ReadLease {
+    public:
+        explicit ReadLease(Database& database);
+        ~ReadLease();
+        int prepare(const std::string& sql, sqlite3_stmt** stmt);
+        operator sqlite3*() const { return conn ? static_cast<sqlite3*>(*conn) : nullptr; }
+    private:
+        Database& database;
+        DbConnection* conn;
+    };
+    
+    // 持有期间独占写连接
+    class WriteLease {
+    public:
+        explicit WriteLease(Database& database);
+        ~WriteLease();
+        int prepare(const std::string& sql, sqlite3_stmt** stmt);
+        operator sqlite3*() const { return conn ? static_cast<sqlite3*>(*conn) : nullptr; }
+        operator DbConnection&() const { return *conn; }
+    private:
+        std::lock_guard<std::mutex> lock;
+        DbConnection* conn;
+    };
+    
+    std::unique_ptr<DbConnection> writer;
+    std::mutex writer_mutex;
+    std::vector<std::unique_ptr<DbConnection>> readers;
+    std::vector<DbConnection*> idle_readers;
+    std::mutex readers_mutex;
+    std::condition_variable reader_available;
+    
+    // 等待写线程提交的消息
+    struct PendingMessage {
+        Message message;
+        std::promise<int> done;  // 事务提交后给出 message_id，失败为 -1
+    };
+    
+    WriteBatchConfig batch_config;
+    std::deque<PendingMessage> pending_messages;
+    std::mutex pending_mutex;
+    std::condition_variable pending_ready;
+    bool stopping = false;
+    std::thread message_writer;
+    
+    void run_message_writer();
+    void write_batch(std::vector<PendingMessage>& batch);
+    
+    DbConnection* acquire_reader();  // 没有空闲连接时等待，连接池为空时返回 nullptr
+    void release_reader(DbConnection* reader);
+    
+    // 一步结构迁移：在一个事务中执行 sql，再由 backfill 为已有数据补齐新表的内容
+    struct Migration {
+        int version;
+        const char* description;
+        const char* sql;
+        bool (Database::*backfill)();  // 可为空
+    };
+    static const std::vector<Migration>& migrations();
+    
+    bool init_database();  // 执行版本号高于 schema_version 的迁移步骤
+    bool backfill_changes();
+    bool backfill_conversations();
+    bool insert_message(DbConnection& db, Message& message);
+    // 更新消息涉及的每个用户的会话行（最后一条消息、预览、未读数）
+    bool update_conversations(DbConnection& db, const Message& message);
+    bool add_group_member(DbConnection& db, int user_id, int group_id);
+    bool execute_sql(sqlite3* db, const std::string& sql);
 };
 
 #endif
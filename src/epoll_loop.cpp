@@ -0,0 +1,232 @@
+#include "epoll_loop.h"
+#include "logger.h"
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <cerrno>
+#include <stdexcept>
+
+extern std::atomic<bool> g_running;
+
+namespace {
+const int MAX_EVENTS = 256;
+const int EPOLL_TIMEOUT_MS = 500;  // 定期醒来检查 g_running
+const size_t READ_CHUNK = 16384;
+const size_t MAX_IOV = 64;  // 一次 sendmsg 使用的 iovec 上限
+}
+
+EpollLoop::EpollLoop(RequestHandler on_request, CloseHandler on_close, size_t max_body_size)
+    : EventLoop(std::move(on_request), std::move(on_close), max_body_size),
+      epoll_fd(-1), listen_fd(-1) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1) {
+        throw std::runtime_error("创建epoll失败");
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = wakeup_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wakeup_fd, &ev);
+}
+
+EpollLoop::~EpollLoop() {
+    if (epoll_fd != -1) {
+        close(epoll_fd);
+    }
+}
+
+void EpollLoop::add_listener(int fd, AcceptHandler handler) {
+    listen_fd = fd;
+    on_accept = std::move(handler);
+    set_nonblocking(listen_fd);
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.fd = listen_fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev) == -1) {
+        throw std::runtime_error("注册监听socket失败");
+    }
+}
+
+void EpollLoop::remove_listener() {
+    if (listen_fd == -1) {
+        return;
+    }
+    // 监听 socket 已交给其他进程时仍然打开，必须显式从 epoll 中删除
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, listen_fd, nullptr);
+    ++stats.syscalls;
+    listen_fd = -1;
+}
+
+void EpollLoop::run() {
+    running = true;
+    epoll_event events[MAX_EVENTS];
+
+    while (running && g_running) {
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, EPOLL_TIMEOUT_MS);
+        ++stats.syscalls;
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("epoll_wait 失败: " + std::to_string(errno));
+            break;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            uint32_t ev = events[i].events;
+
+            if (fd == wakeup_fd) {
+                uint64_t value;
+                ssize_t r = read(wakeup_fd, &value, sizeof(value));
+                (void)r;
+                ++stats.syscalls;
+                run_pending_tasks();
+                continue;
+            }
+
+            if (fd == listen_fd) {
+                handle_accept();
+                continue;
+            }
+
+            auto it = connections.find(fd);
+            if (it == connections.end()) {
+                continue;
+            }
+            ConnectionPtr conn = it->second;
+
+            if (ev & (EPOLLERR | EPOLLHUP)) {
+                close_connection(conn);
+                continue;
+            }
+            if (ev & (EPOLLIN | EPOLLRDHUP)) {
+                handle_read(conn);
+            }
+            if (!conn->closed && (ev & EPOLLOUT)) {
+                flush(conn);
+            }
+        }
+    }
+
+    // 退出前处理已投递的任务，避免连接 fd 泄漏
+    run_pending_tasks();
+    running = false;
+}
+
+void EpollLoop::handle_accept() {
+    // 边缘触发：必须一次性接受所有等待中的连接
+    while (true) {
+        sockaddr_in client_addr{};
+        socklen_t client_len = sizeof(client_addr);
+        int client_fd = accept4(listen_fd, (sockaddr*)&client_addr, &client_len,
+                                SOCK_NONBLOCK | SOCK_CLOEXEC);
+        ++stats.syscalls;
+        if (client_fd == -1) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_WARNING("accept 失败: " + std::to_string(errno));
+            }
+            break;
+        }
+        accept_connection(client_fd);
+    }
+}
+
+void EpollLoop::register_connection(int client_fd) {
+    if (!running && !g_running) {
+        close(client_fd);
+        return;
+    }
+
+    // 连接由 accept4(SOCK_NONBLOCK) 创建，已是非阻塞模式
+    int opt = 1;
+    setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.fd = client_fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_fd, &ev) == -1) {
+        close(client_fd);
+        return;
+    }
+    stats.syscalls += 2;
+
+    add_to_loop(std::make_shared<Connection>(client_fd, this));
+}
+
+void EpollLoop::handle_read(const ConnectionPtr& conn) {
+    char buffer[READ_CHUNK];
+    const size_t limit = max_buffered();
+    conn->read_paused = false;
+
+    // 边缘触发：读到 EAGAIN 为止
+    while (!conn->peer_closed) {
+        if (conn->read_buffer.size() >= limit) {
+            conn->read_paused = true;
+            break;
+        }
+        ssize_t bytes_read = recv(conn->fd, buffer, sizeof(buffer), 0);
+        ++stats.syscalls;
+        if (bytes_read > 0) {
+            append_read_data(conn, buffer, bytes_read);
+            continue;
+        }
+        if (bytes_read == 0) {
+            conn->peer_closed = true;
+            break;
+        }
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            close_connection(conn);
+            return;
+        }
+        break;
+    }
+
+    on_read(conn);
+}
+
+void EpollLoop::resume_read(const ConnectionPtr& conn) {
+    // 边缘触发下暂停期间到达的数据不会再次通知，需要主动读取
+    handle_read(conn);
+}
+
+void EpollLoop::flush(const ConnectionPtr& conn) {
+    // 把排队的多个响应合并成一次 sendmsg，部分写入时等待下一次 EPOLLOUT
+    while (!conn->write_queue.empty()) {
+        iovec iov[MAX_IOV];
+        size_t count = 0;
+        for (auto it = conn->write_queue.begin();
+             it != conn->write_queue.end() && count + HttpResponse::IOV_COUNT <= MAX_IOV; ++it) {
+            // 状态行、响应头、响应体各占一个 iovec，响应体不做拷贝
+            count += it->fill_iovec(iov + count, it == conn->write_queue.begin() ? conn->write_offset : 0);
+        }
+
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        ssize_t sent = sendmsg(conn->fd, &msg, MSG_NOSIGNAL);
+        ++stats.syscalls;
+        if (sent > 0) {
+            consume_written(conn, sent);
+            continue;
+        }
+        if (sent == -1 && errno == EINTR) continue;
+        if (sent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        close_connection(conn);
+        return;
+    }
+
+    on_write_drained(conn);
+}
+
+void EpollLoop::release_connection(const ConnectionPtr& conn) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->fd, nullptr);
+    close(conn->fd);
+    stats.syscalls += 2;
+}
@@ -0,0 +1,31 @@
+#ifndef EPOLL_LOOP_H
+#define EPOLL_LOOP_H
+
+#include "event_loop.h"
+
+// 基于边缘触发 epoll 的事件循环
+class EpollLoop : public EventLoop {
+public:
+    EpollLoop(RequestHandler on_request, CloseHandler on_close, size_t max_body_size);
+    ~EpollLoop() override;
+
+    void add_listener(int listen_fd, AcceptHandler on_accept) override;
+    void run() override;
+    const char* backend_name() const override { return "epoll"; }
+
+protected:
+    void register_connection(int client_fd) override;
+    void flush(const ConnectionPtr& conn) override;
+    void resume_read(const ConnectionPtr& conn) override;
+    void release_connection(const ConnectionPtr& conn) override;
+    void remove_listener() override;
+
+private:
+    int epoll_fd;
+    int listen_fd;
+
+    void handle_accept();
+    void handle_read(const ConnectionPtr& conn);
+};
+
+#endif // EPOLL_LOOP_H
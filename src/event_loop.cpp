@@ -0,0 +1,435 @@
+#include "event_loop.h"
+#include "epoll_loop.h"
+#include "uring_loop.h"
+#include "logger.h"
+#include "http_parser.h"
+#include "http_response.h"
+#include "websocket.h"
+#include "push_hub.h"
+#include <sys/eventfd.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdexcept>
+#include <algorithm>
+
+bool set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags == -1) {
+        return false;
+    }
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+EventLoop::EventLoop(RequestHandler on_request, CloseHandler on_close, size_t max_body_size)
+    : on_request(std::move(on_request)), on_close(std::move(on_close)),
+      max_body_size(max_body_size), running(false), num_connections(0), draining(false), wakeup_fd(-1) {
+    wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_fd == -1) {
+        throw std::runtime_error("创建eventfd失败");
+    }
+}
+
+EventLoop::~EventLoop() {
+    for (auto& pair : connections) {
+        close(pair.first);
+    }
+    connections.clear();
+    if (wakeup_fd != -1) {
+        close(wakeup_fd);
+    }
+}
+
+std::unique_ptr<EventLoop> EventLoop::create(IoBackend backend, RequestHandler on_request,
+                                             CloseHandler on_close, size_t max_body_size) {
+    if (backend == IoBackend::IO_URING) {
+        try {
+            return std::make_unique<UringLoop>(on_request, on_close, max_body_size);
+        } catch (const std::exception& e) {
+            LOG_WARNING(std::string("io_uring 不可用，改用 epoll: ") + e.what());
+        }
+    }
+    return std::make_unique<EpollLoop>(std::move(on_request), std::move(on_close), max_body_size);
+}
+
+void EventLoop::set_push_queue_limits(const PushQueueLimits& limits) {
+    push_limits = limits;
+    push_limits.high_watermark = std::max<size_t>(1, push_limits.high_watermark);
+    push_limits.low_watermark = std::min(push_limits.low_watermark, push_limits.high_watermark - 1);
+}
+
+void EventLoop::add_connection(int client_fd) {
+    post([this, client_fd]() {
+        register_connection(client_fd);
+    });
+}
+
+void EventLoop::post(std::function<void()> task) {
+    bool need_wakeup;
+    {
+        std::lock_guard<std::mutex> lock(task_mutex);
+        // 队列非空说明已经唤醒过、循环还没取走任务，不必重复写 eventfd
+        need_wakeup = pending_tasks.empty();
+        pending_tasks.push_back(std::move(task));
+    }
+    if (need_wakeup) {
+        wakeup();
+    }
+}
+
+void EventLoop::wakeup() {
+    uint64_t one = 1;
+    ssize_t n = write(wakeup_fd, &one, sizeof(one));
+    (void)n;
+    ++stats.syscalls;
+}
+
+void EventLoop::send_response(const ConnectionPtr& conn, HttpResponse response) {
+    post([this, conn, response = std::move(response)]() mutable {
+        complete_request(conn, response);
+    });
+}
+
+void EventLoop::send_frames(std::vector<ConnectionPtr> conns, std::shared_ptr<const std::string> data) {
+    post([this, conns = std::move(conns), data = std::move(data)]() {
+        for (const auto& conn : conns) {
+            if (conn->closed || !(conn->websocket || conn->event_stream) || conn->close_after_write) {
+                continue;
+            }
+            if (queue_push_frame(conn, data)) {
+                flush(conn);
+            }
+        }
+    });
+}
+
+void EventLoop::end_stream(const ConnectionPtr& conn) {
+    post([this, conn]() {
+        if (conn->closed) {
+            return;
+        }
+        conn->close_after_write = true;
+        if (conn->write_queue.empty()) {
+            close_connection(conn);
+        }
+    });
+}
+
+void EventLoop::stop() {
+    running = false;
+    post([]() {});
+}
+
+void EventLoop::drain() {
+    post([this]() {
+        draining = true;
+        remove_listener();
+        for (auto& pair : connections) {
+            if (pair.second->busy) {
+                pair.second->keep_alive = false;
+            }
+        }
+    });
+}
+
+void EventLoop::close_idle_connections() {
+    post([this]() {
+        // 只收到部分请求的连接继续接收，处理完这个请求后关闭
+        std::vector<ConnectionPtr> idle;
+        for (auto& pair : connections) {
+            const ConnectionPtr& conn = pair.second;
+            if (conn->websocket && !conn->close_after_write) {
+                // WebSocket 连接先发送关闭帧，客户端据此重连
+                queue_frame(conn, encode_websocket_close(WS_CLOSE_GOING_AWAY));
+                conn->close_after_write = true;
+                flush(conn);
+            } else if (conn->event_stream && !conn->write_queue.empty()) {
+                // SSE 连接发送完已排队的事件后关闭，客户端带 Last-Event-ID 重连
+                conn->close_after_write = true;
+            } else if (!conn->busy && conn->write_queue.empty() && conn->read_buffer.empty()) {
+                idle.push_back(conn);
+            }
+        }
+        for (auto& conn : idle) {
+            close_connection(conn);
+        }
+    });
+}
+
+size_t EventLoop::connection_count() const {
+    return num_connections;
+}
+
+const IoStats& EventLoop::io_stats() const {
+    return stats;
+}
+
+const BufferPoolStats& EventLoop::buffer_stats() const {
+    return buffers.stats();
+}
+
+size_t EventLoop::max_buffered() const {
+    // 单个连接最多缓冲一个最大请求的数据，超出时暂停读取，等待已有请求处理完
+    return MAX_HEADER_SIZE + max_body_size;
+}
+
+void EventLoop::run_pending_tasks() {
+    std::vector<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(task_mutex);
+        tasks.swap(pending_tasks);
+    }
+    for (auto& task : tasks) {
+        task();
+    }
+}
+
+void EventLoop::accept_connection(int client_fd) {
+    if (on_accept) {
+        on_accept(client_fd);
+    } else {
+        register_connection(client_fd);
+    }
+}
+
+void EventLoop::add_to_loop(const ConnectionPtr& conn) {
+    connections[conn->fd] = conn;
+    ++num_connections;
+    LOG_DEBUG("新客户端连接，fd: " + std::to_string(conn->fd));
+}
+
+void EventLoop::append_read_data(const ConnectionPtr& conn, const char* data, size_t length) {
+    buffers.ensure(conn->read_buffer);
+    conn->read_buffer.append(data, length);
+}
+
+void EventLoop::on_read(const ConnectionPtr& conn) {
+    if (conn->websocket) {
+        handle_websocket_data(conn);
+    } else if (conn->event_stream) {
+        conn->read_buffer.clear();  // SSE 连接不再接收请求
+    } else {
+        dispatch_request(conn);
+    }
+
+    // 没有待处理的请求和待发送的数据时才能立即关闭
+    if (conn->peer_closed && !conn->closed && !conn->busy && conn->write_queue.empty()) {
+        close_connection(conn);
+    }
+}
+
+void EventLoop::dispatch_request(const ConnectionPtr& conn) {
+    if (conn->closed || conn->busy || conn->close_after_write || conn->read_buffer.empty()) {
+        return;
+    }
+
+    RequestFrame frame;
+    FrameStatus status = frame_http_request(conn->read_buffer, max_body_size, frame);
+    if (status == FrameStatus::INCOMPLETE) {
+        return;
+    }
+    if (status != FrameStatus::COMPLETE) {
+        // 协议错误后无法再确定请求边界，回复错误并关闭连接
+        HttpResponse response = status == FrameStatus::TOO_LARGE
+            ? create_http_error_response(413, "请求过大")
+            : create_http_error_response(400, "请求格式错误");
+        conn->read_buffer.clear();
+        conn->close_after_write = true;
+        response.finalize();
+        conn->write_queue.push_back(std::move(response));
+        flush(conn);
+        return;
+    }
+
+    // 请求缓冲区上一次使用后已归还，读缓冲区恰好是一个完整请求时直接交换
+    if (frame.length == conn->read_buffer.size()) {
+        conn->request_buffer.swap(conn->read_buffer);
+    } else {
+        buffers.ensure(conn->request_buffer);
+        conn->request_buffer.assign(conn->read_buffer, 0, frame.length);
+        conn->read_buffer.erase(0, frame.length);
+    }
+    conn->busy = true;
+    conn->keep_alive = frame.keep_alive && !draining;
+    ++stats.requests;
+    on_request(conn, conn->request_buffer);
+}
+
+void EventLoop::complete_request(const ConnectionPtr& conn, HttpResponse& response) {
+    conn->busy = false;
+    buffers.release(conn->request_buffer);
+    if (conn->closed) {
+        return;  // 处理期间连接已断开，丢弃响应
+    }
+
+    HttpResponse::Kind kind = response.kind();
+    if (kind == HttpResponse::Kind::DEFERRED) {
+        // 请求仍在处理中，登记方稍后通过 send_response 回复
+        conn->busy = true;
+        response.connection_handler()(conn);
+        return;
+    }
+    if (kind == HttpResponse::Kind::WEBSOCKET || kind == HttpResponse::Kind::EVENT_STREAM) {
+        // 握手响应之后收到的数据都是 WebSocket 帧；SSE 连接之后只发送事件
+        HttpResponse::ConnectionHandler on_open = response.connection_handler();
+        conn->websocket = kind == HttpResponse::Kind::WEBSOCKET;
+        conn->event_stream = kind == HttpResponse::Kind::EVENT_STREAM;
+        conn->write_queue.push_back(std::move(response));
+        flush(conn);
+        if (conn->closed) {
+            return;
+        }
+        on_open(conn);
+        on_read(conn);
+        if (!conn->closed && conn->read_paused) {
+            resume_read(conn);
+        }
+        return;
+    }
+
+    if (!conn->keep_alive) {
+        // 客户端要求关闭连接时补充 Connection: close
+        response.add_header("Connection", "close");
+        conn->close_after_write = true;
+    }
+    response.finalize();
+    conn->write_queue.push_back(std::move(response));
+    flush(conn);
+    if (conn->closed) {
+        return;
+    }
+
+    dispatch_request(conn);
+    if (conn->read_paused && !conn->busy) {
+        resume_read(conn);
+    }
+}
+
+void EventLoop::handle_websocket_data(const ConnectionPtr& conn) {
+    bool queued = false;
+    WebSocketFrame frame;
+    while (!conn->closed && !conn->close_after_write && !conn->read_buffer.empty()) {
+        FrameStatus status = parse_websocket_frame(conn->read_buffer, frame);
+        if (status == FrameStatus::INCOMPLETE) {
+            break;
+        }
+        if (status != FrameStatus::COMPLETE) {
+            conn->read_buffer.clear();
+            queue_frame(conn, encode_websocket_close(status == FrameStatus::TOO_LARGE
+                                                     ? WS_CLOSE_TOO_LARGE : WS_CLOSE_PROTOCOL_ERROR));
+            conn->close_after_write = true;
+            queued = true;
+            break;
+        }
+        conn->read_buffer.erase(0, frame.length);
+
+        if (frame.opcode == WebSocketOpcode::PING) {
+            queue_frame(conn, encode_websocket_frame(WebSocketOpcode::PONG, frame.payload));
+            queued = true;
+        } else if (frame.opcode == WebSocketOpcode::CLOSE) {
+            // 回显客户端的关闭状态码，发送后关闭连接
+            queue_frame(conn, encode_websocket_frame(WebSocketOpcode::CLOSE, frame.payload.substr(0, 2)));
+            conn->close_after_write = true;
+            queued = true;
+        }
+        // 推送通道不处理客户端发来的数据帧
+    }
+    if (queued && !conn->closed) {
+        flush(conn);
+    }
+}
+
+void EventLoop::queue_frame(const ConnectionPtr& conn, std::string frame) {
+    conn->write_queue.push_back(HttpResponse::raw(std::move(frame)));
+}
+
+bool EventLoop::queue_push_frame(const ConnectionPtr& conn, const std::shared_ptr<const std::string>& data) {
+    auto& queue = conn->write_queue;
+    if (queue.size() >= push_limits.high_watermark) {
+        ++conn->push_stats.overflows;
+        if (push_limits.policy == OverflowPolicy::DISCONNECT) {
+            LOG_WARNING("推送队列溢出，断开慢速连接，fd: " + std::to_string(conn->fd));
+            close_connection(conn);
+            return false;
+        }
+
+        // 只丢弃尚未开始发送的推送帧（包括之前的 resync 提示），握手响应、控制帧和发送了一半的帧保留
+        size_t to_drop = queue.size() - push_limits.low_watermark;
+        size_t dropped = 0;
+        auto first = queue.begin() + (conn->write_offset > 0 ? 1 : 0);
+        auto last = std::remove_if(first, queue.end(), [&](const HttpResponse& frame) {
+            if (dropped < to_drop && frame.is_shared()) {
+                ++dropped;
+                return true;
+            }
+            return false;
+        });
+        queue.erase(last, queue.end());
+        conn->push_stats.dropped += dropped;
+
+        // 提示客户端有事件被丢弃，应按最后收到的事件ID重新拉取；dropped 为该连接累计丢弃的帧数
+        PushEvent resync{"resync", 0, "{\"dropped\":" + std::to_string(conn->push_stats.dropped.load()) + "}"};
+        queue.push_back(HttpResponse::raw(std::make_shared<const std::string>(
+            conn->websocket ? encode_websocket_frame(WebSocketOpcode::TEXT, format_event_json(resync))
+                            : format_sse_event(resync))));
+    }
+    queue.push_back(HttpResponse::raw(data));
+    update_queue_depth(conn);
+    return true;
+}
+
+void EventLoop::update_queue_depth(const ConnectionPtr& conn) {
+    size_t depth = conn->write_queue.size();
+    conn->push_stats.depth = depth;
+    if (depth > conn->push_stats.peak_depth) {
+        conn->push_stats.peak_depth = depth;
+    }
+}
+
+void EventLoop::consume_written(const ConnectionPtr& conn, size_t n) {
+    while (n > 0 && !conn->write_queue.empty()) {
+        size_t remaining = conn->write_queue.front().size() - conn->write_offset;
+        if (n < remaining) {
+            conn->write_offset += n;
+            break;
+        }
+        n -= remaining;
+        conn->write_queue.pop_front();
+        conn->write_offset = 0;
+    }
+    // 部分发送时队列中可能已经弹出了完整的帧，同样要更新
+    if (conn->websocket || conn->event_stream) {
+        update_queue_depth(conn);
+    }
+}
+
+void EventLoop::on_write_drained(const ConnectionPtr& conn) {
+    conn->write_offset = 0;
+    if (conn->close_after_write || (conn->peer_closed && !conn->busy && conn->read_buffer.empty())) {
+        close_connection(conn);
+        return;
+    }
+    // 没有待处理的数据时把读缓冲区归还，空闲连接不占用缓冲区
+    if (conn->read_buffer.empty()) {
+        buffers.release(conn->read_buffer);
+    }
+}
+
+void EventLoop::close_connection(const ConnectionPtr& conn) {
+    if (conn->closed) {
+        return;
+    }
+    conn->closed = true;
+
+    // 客户端断开连接，清理在线状态
+    LOG_DEBUG("客户端断开连接，fd: " + std::to_string(conn->fd));
+    on_close(conn);
+
+    connections.erase(conn->fd);
+    --num_connections;
+    buffers.release(conn->read_buffer);
+    if (!conn->busy) {
+        // 处理中的请求缓冲区由工作线程使用，在 complete_request 中归还
+        buffers.release(conn->request_buffer);
+    }
+    release_connection(conn);
+}
@@ -0,0 +1,149 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include "connection.h"
+#include "buffer_pool.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+// 可选的 I/O 后端
+enum class IoBackend {
+    EPOLL,
+    IO_URING
+};
+
+// I/O 统计，用于比较不同后端的系统调用开销
+struct IoStats {
+    std::atomic<uint64_t> syscalls{0};
+    std::atomic<uint64_t> requests{0};
+};
+
+// 推送连接发送队列溢出时的处理方式
+enum class OverflowPolicy {
+    DROP_OLDEST,  // 丢弃最早排队的推送帧，并补发一个 resync 事件提示客户端重新拉取
+    DISCONNECT    // 关闭连接，客户端重连后重新拉取
+};
+
+// 推送连接（WebSocket / SSE）的发送队列上限，按帧数计
+struct PushQueueLimits {
+    size_t high_watermark = 256;  // 排队帧数达到高水位时按 policy 处理
+    size_t low_watermark = 64;    // DROP_OLDEST 丢弃到低水位，之后的推送不会立即再次溢出
+    OverflowPolicy policy = OverflowPolicy::DROP_OLDEST;
+};
+
+// 事件循环基类：每个 EventLoop 运行在一个线程中，负责若干连接的读写
+// 按 HTTP/1.1 Content-Length 切分请求，支持持久连接和流水线请求
+// 请求交给 RequestHandler 处理（通常转交工作线程池），处理结果通过 send_response 返回
+// 请求数据指向连接的请求缓冲区，在 send_response 之前保持有效
+// 同一连接同时最多只有一个请求在处理中，保证响应顺序
+// 具体的读写由 I/O 后端（epoll / io_uring）实现
+class EventLoop {
+public:
+    using RequestHandler = std::function<void(const ConnectionPtr& conn, std::string_view request)>;
+    using CloseHandler = std::function<void(const ConnectionPtr& conn)>;
+    using AcceptHandler = std::function<void(int client_fd)>;
+
+    EventLoop(RequestHandler on_request, CloseHandler on_close, size_t max_body_size);
+    virtual ~EventLoop();
+
+    // 按指定后端创建事件循环，io_uring 不可用时回退到 epoll
+    static std::unique_ptr<EventLoop> create(IoBackend backend, RequestHandler on_request,
+                                             CloseHandler on_close, size_t max_body_size);
+
+    // 设置推送连接的发送队列上限（只能在 run() 之前调用）
+    void set_push_queue_limits(const PushQueueLimits& limits);
+
+    // 注册监听 socket，新连接交给 on_accept 分配（只能在 run() 之前调用）
+    // on_accept 为空时新连接直接由本循环处理
+    virtual void add_listener(int listen_fd, AcceptHandler on_accept) = 0;
+    // 把已接受的连接交给本循环管理（线程安全）
+    void add_connection(int client_fd);
+    // 在本循环线程中执行任务（线程安全）
+    void post(std::function<void()> task);
+    // 返回请求的处理结果并继续处理该连接后续的请求（线程安全）
+    void send_response(const ConnectionPtr& conn, HttpResponse response);
+    // 在本循环的一批 WebSocket / SSE 连接上发送同一段已编码的数据，数据在连接间共享，
+    // 整批只投递一次任务；已关闭的连接跳过（线程安全）
+    void send_frames(std::vector<ConnectionPtr> conns, std::shared_ptr<const std::string> data);
+    // 发送完已排队的数据后关闭 WebSocket / SSE 连接（线程安全）
+    void end_stream(const ConnectionPtr& conn);
+
+    virtual void run() = 0;
+    void stop();
+    // 停止接受新连接，此后每个连接的下一个响应带上 Connection: close 并在发送后关闭（线程安全）
+    void drain();
+    // 关闭没有请求在处理、也没有待发送数据的连接（线程安全）
+    void close_idle_connections();
+
+    virtual const char* backend_name() const = 0;
+    size_t connection_count() const;
+    const IoStats& io_stats() const;
+    const BufferPoolStats& buffer_stats() const;
+
+protected:
+    RequestHandler on_request;
+    CloseHandler on_close;
+    AcceptHandler on_accept;
+    size_t max_body_size;
+    std::atomic<bool> running;
+    std::atomic<size_t> num_connections;
+    bool draining;  // 已调用 drain()，响应发送完后关闭连接
+    IoStats stats;
+    BufferPool buffers;  // 连接读缓冲区和请求缓冲区
+    PushQueueLimits push_limits;
+    int wakeup_fd;  // 跨线程投递任务时唤醒本循环
+
+    std::unordered_map<int, ConnectionPtr> connections;
+
+    // 以下由 I/O 后端实现
+    virtual void register_connection(int client_fd) = 0;
+    // 发送 write_queue 中的数据，全部发送完后调用 on_write_drained
+    virtual void flush(const ConnectionPtr& conn) = 0;
+    // 恢复因缓冲区已满而暂停的读取
+    virtual void resume_read(const ConnectionPtr& conn) = 0;
+    // 从后端注销连接并关闭 fd
+    virtual void release_connection(const ConnectionPtr& conn) = 0;
+    // 停止在监听 socket 上接受连接（监听 socket 由调用 add_listener 的一方关闭）
+    virtual void remove_listener() = 0;
+
+    // 把收到的数据追加到连接的读缓冲区
+    void append_read_data(const ConnectionPtr& conn, const char* data, size_t length);
+    // 后端收到新数据或对端关闭后调用
+    void on_read(const ConnectionPtr& conn);
+    // 从 write_queue 开头移除已发送的 n 字节
+    void consume_written(const ConnectionPtr& conn, size_t n);
+    // write_queue 全部发送完后调用
+    void on_write_drained(const ConnectionPtr& conn);
+    // 新连接加入本循环
+    void add_to_loop(const ConnectionPtr& conn);
+    void close_connection(const ConnectionPtr& conn);
+    void run_pending_tasks();
+    // 监听 socket 上接受了新连接
+    void accept_connection(int client_fd);
+    // 单个连接最多缓冲的请求数据，超出时暂停读取
+    size_t max_buffered() const;
+
+private:
+    std::mutex task_mutex;
+    std::vector<std::function<void()>> pending_tasks;
+
+    void wakeup();
+    void dispatch_request(const ConnectionPtr& conn);
+    // 处理 WebSocket 连接上收到的帧（ping / close），数据帧被忽略
+    void handle_websocket_data(const ConnectionPtr& conn);
+    void queue_frame(const ConnectionPtr& conn, std::string frame);
+    // 把推送帧加入发送队列，超过高水位时按 push_limits.policy 处理，返回 false 表示连接已关闭
+    bool queue_push_frame(const ConnectionPtr& conn, const std::shared_ptr<const std::string>& data);
+    void update_queue_depth(const ConnectionPtr& conn);
+    void complete_request(const ConnectionPtr& conn, HttpResponse& response);
+};
+
+// 设置 fd 为非阻塞模式
+bool set_nonblocking(int fd);
+
+#endif // EVENT_LOOP_H
@@ -14,7 +14,7 @@ FileManager::FileManager(const std::string& upload_dir, UserManager* user_manage
 FileManager::~FileManager() {
 }
 
-std::string FileManager::upload_file(const std::string& body) {
+HttpResponse FileManager::upload_file(std::string_view body) {
     std::string username = parse_json_value(body, "username");
     if (username.empty()) {
         return create_json_response("error", "用户名不能为空");
@@ -64,21 +64,9 @@ std::string FileManager::upload_file(const std::string& body) {
     return create_json_response("success", "文件上传成功");
 }
 
-std::string FileManager::download_file(const std::string& query_string) {
+HttpResponse FileManager::download_file(std::string_view query_string) {
     // 解析查询参数中的filename
-    std::string filename = "";
-    if (!query_string.empty()) {
-        std::string search_key = "filename=";
-        size_t pos = query_string.find(search_key);
-        if (pos != std::string::npos) {
-            pos += search_key.length();
-            size_t end = query_string.find('&', pos);
-            if (end == std::string::npos) {
-                end = query_string.length();
-            }
-            filename = query_string.substr(pos, end - pos);
-        }
-    }
+    std::string filename(get_query_param(query_string, "filename"));
     
     if (filename.empty()) {
         return create_json_response("error", "文件名不能为空");
@@ -14,8 +14,8 @@ public:
     ~FileManager();
     
     // 文件API
-    std::string upload_file(const std::string& body);
-    std::string download_file(const std::string& query_string);
+    HttpResponse upload_file(std::string_view body);
+    HttpResponse download_file(std::string_view query_string);
     
 private:
     std::string upload_dir;
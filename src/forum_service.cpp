@@ -2,6 +2,7 @@
 #include "database.h"
 #include "user_manager.h"
 #include "common.h"
+#include "arena.h"
 #include <iostream>
 #include <sstream>
 
@@ -12,7 +13,7 @@ ForumService::ForumService(Database* db, UserManager* user_manager)
 ForumService::~ForumService() {
 }
 
-std::string ForumService::create_post(const std::string& body) {
+HttpResponse ForumService::create_post(std::string_view body) {
     std::string username = parse_json_value(body, "username");
     if (username.empty()) {
         return create_json_response("error", "用户名不能为空");
@@ -49,79 +50,58 @@ std::string ForumService::create_post(const std::string& body) {
     }
 }
 
-std::string ForumService::get_posts(const std::string& query_string) {
-    // 解析分页参数
-    int page = 1;
-    int page_size = 20;
-    
-    if (!query_string.empty()) {
-        // 解析 page
-        size_t pos = query_string.find("page=");
-        if (pos != std::string::npos) {
-            pos += 5;
-            size_t end = query_string.find('&', pos);
-            if (end == std::string::npos) end = query_string.length();
-            try {
-                page = safe_stoi(query_string.substr(pos, end - pos));
-                if (page <= 0) page = 1;
-            } catch (...) {}
-        }
-        
-        // 解析 page_size
-        pos = query_string.find("page_size=");
-        if (pos != std::string::npos) {
-            pos += 10;
-            size_t end = query_string.find('&', pos);
-            if (end == std::string::npos) end = query_string.length();
-            try {
-                page_size = safe_stoi(query_string.substr(pos, end - pos));
-                if (page_size <= 0 || page_size > 100) page_size = 20;
-            } catch (...) {}
-        }
-    }
-    
-    std::vector<Post> posts = db->get_posts(page, page_size);
-    
-    
-    std::ostringstream json_array;
-    json_array << "[";
+HttpResponse ForumService::get_posts(std::string_view query_string) {
+    // 解析分页参数：带 before_id 时按游标翻页，否则按页码
+    int page = safe_stoi(get_query_param(query_string, "page"), 1);
+    if (page <= 0) page = 1;
+    int page_size = safe_stoi(get_query_param(query_string, "page_size"), 20);
+    if (page_size <= 0 || page_size > 100) page_size = 20;
+    std::string_view before_param = get_query_param(query_string, "before_id");
+    bool keyset = !before_param.empty();
+    int before_id = safe_stoi(before_param, -1);
+    
+    std::vector<Post> posts = keyset ? db->get_posts_before(before_id, page_size)
+                                     : db->get_posts(page, page_size);
+    
+    // 在请求内存区中拼接，最后只把完整的响应体复制一次
+    std::pmr::string json(&request_arena());
+    json.reserve(64 + posts.size() * 512);
+    json.append("{\"status\":\"success\",\"data\":[");
     
     for (size_t i = 0; i < posts.size(); ++i) {
         if (i > 0) {
-            json_array << ",";
-        }
-        
-        // 获取用户名
-        std::string username = db->get_username_by_id(posts[i].user_id);
-        if (!username.empty()) {
-            posts[i].username = username;
+            json.append(",");
         }
         
-        json_array << "{\"post_id\":" << posts[i].post_id
-                  << ",\"user_id\":" << posts[i].user_id
-                  << ",\"username\":\"" << escape_json_string(posts[i].username) << "\""
-                  << ",\"title\":\"" << escape_json_string(posts[i].title) << "\""
-                  << ",\"content\":\"" << escape_json_string(posts[i].content) << "\""
-                  << ",\"timestamp\":\"" << escape_json_string(posts[i].timestamp) << "\"}";
+        json.append("{\"post_id\":").append(std::to_string(posts[i].post_id))
+            .append(",\"user_id\":").append(std::to_string(posts[i].user_id))
+            .append(",\"username\":\"");
+        append_escaped_json(json, posts[i].username);
+        json.append("\",\"title\":\"");
+        append_escaped_json(json, posts[i].title);
+        json.append("\",\"content\":\"");
+        append_escaped_json(json, posts[i].content);
+        json.append("\",\"timestamp\":\"");
+        append_escaped_json(json, posts[i].timestamp);
+        json.append("\"}");
+    }
+    
+    // 包含分页信息；下一页以 next_before_id 作为 before_id，没有更多帖子时为 -1
+    bool has_more = posts.size() >= (size_t)page_size;
+    json.append("]");
+    if (keyset) {
+        json.append(",\"before_id\":").append(std::to_string(before_id));
+    } else {
+        json.append(",\"page\":").append(std::to_string(page));
     }
+    json.append(",\"page_size\":").append(std::to_string(page_size))
+        .append(",\"has_more\":").append(has_more ? "true" : "false")
+        .append(",\"next_before_id\":").append(std::to_string(has_more ? posts.back().post_id : -1)).append("}");
     
-    json_array << "]";
-    
-    // 构建响应，包含分页信息
-    std::string result = "{\"status\":\"success\",\"data\":" + json_array.str() + 
-                         ",\"page\":" + std::to_string(page) +
-                         ",\"page_size\":" + std::to_string(page_size) +
-                         ",\"has_more\":" + (posts.size() >= (size_t)page_size ? "true" : "false") + "}";
-    
-    return "HTTP/1.1 200 OK\r\n"
-           "Content-Type: application/json\r\n"
-           "Content-Length: " + std::to_string(result.length()) + "\r\n"
-           "Connection: close\r\n"
-           "Access-Control-Allow-Origin: *\r\n"
-           "\r\n" + result;
+    return HttpResponse(200, std::string(json));
 }
 
-std::string ForumService::reply_post(const std::string& body) {
+HttpResponse ForumService::reply_post(std::string_view body) {
     std::string username = parse_json_value(body, "username");
     if (username.empty()) {
         return create_json_response("error", "用户名不能为空");
@@ -149,21 +129,9 @@ std::string ForumService::reply_post(const std::string& body) {
     }
 }
 
-std::string ForumService::get_post_replies(const std::string& query_string) {
+HttpResponse ForumService::get_post_replies(std::string_view query_string) {
     // 解析查询参数中的post_id
-    std::string post_id_str = "";
-    if (!query_string.empty()) {
-        std::string search_key = "post_id=";
-        size_t pos = query_string.find(search_key);
-        if (pos != std::string::npos) {
-            pos += search_key.length();
-            size_t end = query_string.find('&', pos);
-            if (end == std::string::npos) {
-                end = query_string.length();
-            }
-            post_id_str = query_string.substr(pos, end - pos);
-        }
-    }
+    std::string post_id_str(get_query_param(query_string, "post_id"));
     
     if (post_id_str.empty()) {
         return create_json_response("error", "帖子ID不能为空");
@@ -178,12 +146,6 @@ std::string ForumService::get_post_replies(const std::string& query_string) {
     for (size_t i = 0; i < replies.size(); ++i) {
         if (i > 0) json_array << ",";
         
-        // 获取用户名
-        std::string username = db->get_username_by_id(replies[i].user_id);
-        if (!username.empty()) {
-            replies[i].username = username;
-        }
-        
         json_array << "{"
                    << "\"reply_id\":" << replies[i].reply_id << ","
                    << "\"post_id\":" << replies[i].post_id << ","
@@ -199,19 +161,13 @@ std::string ForumService::get_post_replies(const std::string& query_string) {
     return create_json_response("success", json_array.str());
 }
 
-std::string ForumService::get_post_detail(int post_id) {
+HttpResponse ForumService::get_post_detail(int post_id) {
     Post post = db->get_post_by_id(post_id);
     
     if (post.post_id == -1) {
         return create_json_response("error", "帖子不存在");
     }
     
-    // 获取用户名
-    std::string username = db->get_username_by_id(post.user_id);
-    if (!username.empty()) {
-        post.username = username;
-    }
-    
     std::ostringstream json;
     json << "{\"post_id\":" << post.post_id
          << ",\"user_id\":" << post.user_id
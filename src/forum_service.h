@@ -16,13 +16,13 @@ public:
     ~ForumService();
     
     // 论坛API
-    std::string create_post(const std::string& body);
-    std::string get_posts(const std::string& query_string);
-    std::string reply_post(const std::string& body);
-    std::string get_post_replies(const std::string& query_string);
+    HttpResponse create_post(std::string_view body);
+    HttpResponse get_posts(std::string_view query_string);
+    HttpResponse reply_post(std::string_view body);
+    HttpResponse get_post_replies(std::string_view query_string);
     
     // 新增：获取单个帖子详情
-    std::string get_post_detail(int post_id);
+    HttpResponse get_post_detail(int post_id);
     
 private:
     Database* db;
@@ -0,0 +1,113 @@
+#include "group_fanout.h"
+#include "push_hub.h"
+#include <algorithm>
+
+GroupFanout::GroupFanout(PushHub* push_hub) : push_hub(push_hub) {
+}
+
+GroupFanout::~GroupFanout() {
+}
+
+void GroupFanout::user_online(int user_id, const std::vector<int>& group_ids) {
+    std::lock_guard<std::mutex> lock(members_mutex);
+    // 重复登录时先移除旧的群组列表，以本次查询的为准
+    auto it = groups_by_user.find(user_id);
+    if (it != groups_by_user.end()) {
+        for (int group_id : it->second) {
+            remove_member(group_id, user_id);
+        }
+    }
+    for (int group_id : group_ids) {
+        members_by_group[group_id].insert(user_id);
+    }
+    groups_by_user[user_id] = group_ids;
+}
+
+void GroupFanout::user_offline(int user_id) {
+    std::lock_guard<std::mutex> lock(members_mutex);
+    auto it = groups_by_user.find(user_id);
+    if (it == groups_by_user.end()) {
+        return;
+    }
+    for (int group_id : it->second) {
+        remove_member(group_id, user_id);
+    }
+    groups_by_user.erase(it);
+}
+
+void GroupFanout::join(int user_id, int group_id) {
+    std::lock_guard<std::mutex> lock(members_mutex);
+    auto it = groups_by_user.find(user_id);
+    if (it == groups_by_user.end()) {
+        return;
+    }
+    if (members_by_group[group_id].insert(user_id).second) {
+        it->second.push_back(group_id);
+    }
+}
+
+void GroupFanout::leave(int user_id, int group_id) {
+    std::lock_guard<std::mutex> lock(members_mutex);
+    auto it = groups_by_user.find(user_id);
+    if (it == groups_by_user.end()) {
+        return;
+    }
+    auto& groups = it->second;
+    groups.erase(std::remove(groups.begin(), groups.end(), group_id), groups.end());
+    remove_member(group_id, user_id);
+}
+
+size_t GroupFanout::publish(int group_id, int exclude_user_id, const PushEvent& event) {
+    std::vector<int> recipients;
+    {
+        std::lock_guard<std::mutex> lock(members_mutex);
+        auto it = members_by_group.find(group_id);
+        if (it == members_by_group.end()) {
+            return 0;
+        }
+        recipients.reserve(it->second.size());
+        for (int user_id : it->second) {
+            if (user_id != exclude_user_id) {
+                recipients.push_back(user_id);
+            }
+        }
+    }
+    // 在锁外推送，成员集合的更新不必等待投递完成
+    push_hub->push(recipients, event);
+    return recipients.size();
+}
+
+size_t GroupFanout::publish_to_peers(int user_id, const PushEvent& event) {
+    std::vector<int> recipients;
+    {
+        std::lock_guard<std::mutex> lock(members_mutex);
+        auto it = groups_by_user.find(user_id);
+        if (it == groups_by_user.end()) {
+            return 0;
+        }
+        std::unordered_set<int> peers;
+        for (int group_id : it->second) {
+            auto group_it = members_by_group.find(group_id);
+            if (group_it == members_by_group.end()) {
+                continue;
+            }
+            peers.insert(group_it->second.begin(), group_it->second.end());
+        }
+        peers.erase(user_id);
+        recipients.assign(peers.begin(), peers.end());
+    }
+    push_hub->push(recipients, event);
+    return recipients.size();
+}
+
+// 集合变空时删除整个条目，映射表只保留当前有在线成员的群组
+void GroupFanout::remove_member(int group_id, int user_id) {
+    auto it = members_by_group.find(group_id);
+    if (it == members_by_group.end()) {
+        return;
+    }
+    it->second.erase(user_id);
+    if (it->second.empty()) {
+        members_by_group.erase(it);
+    }
+}
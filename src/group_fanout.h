@@ -0,0 +1,42 @@
+#ifndef GROUP_FANOUT_H
+#define GROUP_FANOUT_H
+
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+
+class PushHub;
+struct PushEvent;
+
+// 群消息扇出：在内存中维护每个群组的在线成员集合（登录、登出、加入、退出群组时更新），
+// 发送群消息时不再查询 group_members 表，事件经 PushHub 只编码一次并按事件循环分批投递
+class GroupFanout {
+public:
+    GroupFanout(PushHub* push_hub);
+    ~GroupFanout();
+
+    // 用户登录后加入其所在群组的在线成员集合
+    void user_online(int user_id, const std::vector<int>& group_ids);
+    // 用户登出后从所有群组的在线成员集合中移除
+    void user_offline(int user_id);
+    // 加入 / 退出群组，用户不在线时忽略
+    void join(int user_id, int group_id);
+    void leave(int user_id, int group_id);
+
+    // 推送给群组中除 exclude_user_id 外的所有在线成员，返回接收事件的成员数
+    size_t publish(int group_id, int exclude_user_id, const PushEvent& event);
+    // 推送给与该用户同在任一群组的其他在线成员（每人一次），用于在线状态变化
+    size_t publish_to_peers(int user_id, const PushEvent& event);
+
+private:
+    PushHub* push_hub;
+    mutable std::mutex members_mutex;
+    std::unordered_map<int, std::unordered_set<int>> members_by_group;
+    std::unordered_map<int, std::vector<int>> groups_by_user;  // 在线用户所在的群组
+
+    // 调用方持有 members_mutex
+    void remove_member(int group_id, int user_id);
+};
+
+#endif // GROUP_FANOUT_H
@@ -0,0 +1,205 @@
+#include "http_parser.h"
+#include <cctype>
+#include <cstdlib>
+
+namespace {
+
+bool iequals(std::string_view a, std::string_view b) {
+    if (a.length() != b.length()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.length(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) !=
+            std::tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool iequals(const std::string& a, size_t pos, size_t len, const char* b) {
+    size_t i = 0;
+    for (; i < len && b[i] != '\0'; ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[pos + i])) !=
+            std::tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return i == len && b[i] == '\0';
+}
+
+// 在 [pos, end) 中查找不区分大小写的子串
+bool icontains(const std::string& s, size_t pos, size_t end, const char* token) {
+    size_t token_len = 0;
+    while (token[token_len] != '\0') ++token_len;
+    for (size_t i = pos; i + token_len <= end; ++i) {
+        if (iequals(s, i, token_len, token)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+FrameStatus frame_http_request(const std::string& buffer, size_t max_body_size, RequestFrame& frame) {
+    size_t header_end = buffer.find("\r\n\r\n");
+    if (header_end == std::string::npos) {
+        return buffer.size() > MAX_HEADER_SIZE ? FrameStatus::TOO_LARGE : FrameStatus::INCOMPLETE;
+    }
+    if (header_end > MAX_HEADER_SIZE) {
+        return FrameStatus::TOO_LARGE;
+    }
+
+    size_t line_end = buffer.find("\r\n");
+    if (line_end == 0) {
+        return FrameStatus::BAD_REQUEST;
+    }
+
+    // 请求行：METHOD PATH VERSION，HTTP/1.0 默认不保持连接
+    size_t version_start = buffer.rfind(' ', line_end);
+    if (version_start == std::string::npos || version_start == 0) {
+        return FrameStatus::BAD_REQUEST;
+    }
+    frame.keep_alive = !iequals(buffer, version_start + 1, line_end - version_start - 1, "HTTP/1.0");
+
+    size_t content_length = 0;
+    bool has_content_length = false;
+    size_t pos = line_end + 2;
+    while (pos < header_end + 2) {
+        size_t eol = buffer.find("\r\n", pos);
+        size_t colon = buffer.find(':', pos);
+        if (colon == std::string::npos || colon > eol) {
+            return FrameStatus::BAD_REQUEST;
+        }
+
+        size_t value_start = colon + 1;
+        while (value_start < eol && (buffer[value_start] == ' ' || buffer[value_start] == '\t')) {
+            ++value_start;
+        }
+
+        if (iequals(buffer, pos, colon - pos, "Content-Length")) {
+            // 只接受十进制数字加可选的结尾空白；重复出现时取值必须相同。
+            // 否则前面的代理和本服务器可能对请求的结束位置理解不同（请求走私）
+            size_t i = value_start;
+            size_t value = 0;
+            for (; i < eol && std::isdigit(static_cast<unsigned char>(buffer[i])); ++i) {
+                value = value * 10 + (buffer[i] - '0');
+                if (value > max_body_size) {
+                    return FrameStatus::TOO_LARGE;
+                }
+            }
+            if (i == value_start) {
+                return FrameStatus::BAD_REQUEST;
+            }
+            for (; i < eol; ++i) {
+                if (buffer[i] != ' ' && buffer[i] != '\t') {
+                    return FrameStatus::BAD_REQUEST;
+                }
+            }
+            if (has_content_length && value != content_length) {
+                return FrameStatus::BAD_REQUEST;
+            }
+            content_length = value;
+            has_content_length = true;
+        } else if (iequals(buffer, pos, colon - pos, "Transfer-Encoding")) {
+            // 不支持分块传输，客户端必须提供 Content-Length
+            return FrameStatus::BAD_REQUEST;
+        } else if (iequals(buffer, pos, colon - pos, "Connection")) {
+            if (icontains(buffer, value_start, eol, "close")) {
+                frame.keep_alive = false;
+            } else if (icontains(buffer, value_start, eol, "keep-alive")) {
+                frame.keep_alive = true;
+            }
+        }
+
+        pos = eol + 2;
+    }
+
+    size_t total = header_end + 4 + content_length;
+    if (buffer.size() < total) {
+        return FrameStatus::INCOMPLETE;
+    }
+
+    frame.length = total;
+    return FrameStatus::COMPLETE;
+}
+
+std::string_view HttpRequest::header(std::string_view name) const {
+    for (size_t i = 0; i < header_count; ++i) {
+        if (iequals(headers[i].name, name)) {
+            return headers[i].value;
+        }
+    }
+    return {};
+}
+
+bool parse_http_request(std::string_view data, HttpRequest& request) {
+    request.header_count = 0;
+
+    // 请求行：METHOD TARGET VERSION
+    size_t line_end = data.find("\r\n");
+    if (line_end == std::string_view::npos) {
+        return false;
+    }
+    std::string_view line = data.substr(0, line_end);
+    size_t method_end = line.find(' ');
+    if (method_end == std::string_view::npos || method_end == 0) {
+        return false;
+    }
+    size_t target_end = line.find(' ', method_end + 1);
+    if (target_end == std::string_view::npos || target_end == method_end + 1) {
+        return false;
+    }
+    request.method = line.substr(0, method_end);
+    std::string_view target = line.substr(method_end + 1, target_end - method_end - 1);
+    request.version = line.substr(target_end + 1);
+
+    size_t query_start = target.find('?');
+    if (query_start == std::string_view::npos) {
+        request.path = target;
+        request.query = {};
+    } else {
+        request.path = target.substr(0, query_start);
+        request.query = target.substr(query_start + 1);
+    }
+
+    // 请求头，直到空行
+    size_t pos = line_end + 2;
+    while (true) {
+        size_t eol = data.find("\r\n", pos);
+        if (eol == std::string_view::npos) {
+            return false;
+        }
+        if (eol == pos) {
+            pos += 2;
+            break;
+        }
+        if (request.header_count == MAX_HEADERS) {
+            return false;
+        }
+
+        std::string_view header_line = data.substr(pos, eol - pos);
+        size_t colon = header_line.find(':');
+        if (colon == std::string_view::npos || colon == 0) {
+            return false;
+        }
+        size_t value_start = colon + 1;
+        size_t value_end = header_line.length();
+        while (value_start < value_end && (header_line[value_start] == ' ' || header_line[value_start] == '\t')) {
+            ++value_start;
+        }
+        while (value_end > value_start && (header_line[value_end - 1] == ' ' || header_line[value_end - 1] == '\t')) {
+            --value_end;
+        }
+
+        HttpHeader& header = request.headers[request.header_count++];
+        header.name = header_line.substr(0, colon);
+        header.value = header_line.substr(value_start, value_end - value_start);
+        pos = eol + 2;
+    }
+
+    // 事件循环已按 Content-Length 切分请求，剩余部分即请求体
+    request.body = data.substr(pos);
+    return true;
+}
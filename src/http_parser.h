@@ -0,0 +1,51 @@
+#ifndef HTTP_PARSER_H
+#define HTTP_PARSER_H
+
+#include <string>
+#include <string_view>
+
+// 请求头部分的最大长度
+const size_t MAX_HEADER_SIZE = 16 * 1024;
+// 单个请求最多解析的请求头数量
+const size_t MAX_HEADERS = 64;
+
+enum class FrameStatus {
+    INCOMPLETE,   // 数据不足，需要继续读取
+    COMPLETE,     // 已得到一个完整请求
+    BAD_REQUEST,  // 请求格式错误
+    TOO_LARGE     // 请求体超过上限
+};
+
+// 从缓冲区开头切分出的一个完整 HTTP 请求
+struct RequestFrame {
+    size_t length;    // 请求总长度（请求头 + 请求体）
+    bool keep_alive;  // 响应后是否保持连接
+};
+
+// 按 Content-Length 从 buffer 开头切分一个请求，支持同一连接上的多个流水线请求
+FrameStatus frame_http_request(const std::string& buffer, size_t max_body_size, RequestFrame& frame);
+
+struct HttpHeader {
+    std::string_view name;
+    std::string_view value;
+};
+
+// 解析后的 HTTP 请求，所有字段都是指向原始请求数据的视图，
+// 使用期间原始数据必须保持有效
+struct HttpRequest {
+    std::string_view method;
+    std::string_view path;     // 不含查询字符串
+    std::string_view query;    // '?' 之后的部分
+    std::string_view version;
+    std::string_view body;
+    HttpHeader headers[MAX_HEADERS];
+    size_t header_count = 0;
+
+    // 按名称查找请求头（不区分大小写），不存在时返回空视图
+    std::string_view header(std::string_view name) const;
+};
+
+// 一次扫描解析完整的 HTTP 请求（请求行、请求头、请求体），不分配内存
+bool parse_http_request(std::string_view data, HttpRequest& request);
+
+#endif // HTTP_PARSER_H
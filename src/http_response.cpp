@@ -0,0 +1,150 @@
+#include "http_response.h"
+
+namespace {
+
+#define COMMON_HEADERS "Content-Type: application/json\r\nAccess-Control-Allow-Origin: *\r\n"
+
+const char* reason_phrase(int status_code) {
+    switch (status_code) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 413: return "Payload Too Large";
+        case 503: return "Service Unavailable";
+        default:  return "Error";
+    }
+}
+
+// 常用状态码的状态行 + 公共响应头，其他状态码返回空视图，在 finalize() 时生成
+std::string_view prerendered_prefix(int status_code) {
+    static const std::string_view ok = "HTTP/1.1 200 OK\r\n" COMMON_HEADERS;
+    static const std::string_view bad_request = "HTTP/1.1 400 Bad Request\r\n" COMMON_HEADERS;
+    static const std::string_view too_large = "HTTP/1.1 413 Payload Too Large\r\n" COMMON_HEADERS;
+    static const std::string_view unavailable = "HTTP/1.1 503 Service Unavailable\r\n" COMMON_HEADERS;
+    switch (status_code) {
+        case 200: return ok;
+        case 400: return bad_request;
+        case 413: return too_large;
+        case 503: return unavailable;
+        default:  return {};
+    }
+}
+
+// SSE 响应没有 Content-Length，连接一直保持到任意一方关闭
+const std::string_view EVENT_STREAM_PREFIX =
+    "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+    "Access-Control-Allow-Origin: *\r\n\r\n";
+
+}  // namespace
+
+HttpResponse::HttpResponse() : HttpResponse(200, std::string()) {
+}
+
+HttpResponse::HttpResponse(int status_code, std::string body)
+    : status(status_code), prefix(prerendered_prefix(status_code)),
+      content(std::move(body)), finalized(false), response_kind(Kind::NORMAL) {
+}
+
+HttpResponse HttpResponse::raw(std::string data) {
+    HttpResponse response(0, std::move(data));
+    response.finalized = true;
+    return response;
+}
+
+HttpResponse HttpResponse::raw(std::shared_ptr<const std::string> data) {
+    HttpResponse response = raw(std::string());
+    response.shared_content = std::move(data);
+    return response;
+}
+
+HttpResponse HttpResponse::switching_protocols(std::string head, ConnectionHandler on_upgrade) {
+    HttpResponse response(101, std::string());
+    response.head = std::move(head);
+    response.finalized = true;
+    response.response_kind = Kind::WEBSOCKET;
+    response.on_connection = std::move(on_upgrade);
+    return response;
+}
+
+HttpResponse HttpResponse::event_stream(std::string events, ConnectionHandler on_open) {
+    HttpResponse response(200, std::move(events));
+    response.prefix = EVENT_STREAM_PREFIX;
+    response.finalized = true;
+    response.response_kind = Kind::EVENT_STREAM;
+    response.on_connection = std::move(on_open);
+    return response;
+}
+
+HttpResponse HttpResponse::deferred(ConnectionHandler on_park) {
+    HttpResponse response;
+    response.finalized = true;
+    response.response_kind = Kind::DEFERRED;
+    response.on_connection = std::move(on_park);
+    return response;
+}
+
+HttpResponse::Kind HttpResponse::kind() const {
+    return response_kind;
+}
+
+bool HttpResponse::is_shared() const {
+    return shared_content != nullptr;
+}
+
+const HttpResponse::ConnectionHandler& HttpResponse::connection_handler() const {
+    return on_connection;
+}
+
+int HttpResponse::status_code() const {
+    return status;
+}
+
+const std::string& HttpResponse::body() const {
+    return shared_content ? *shared_content : content;
+}
+
+void HttpResponse::add_header(std::string_view name, std::string_view value) {
+    head.append(name).append(": ").append(value).append("\r\n");
+}
+
+void HttpResponse::finalize() {
+    if (finalized) {
+        return;
+    }
+    finalized = true;
+
+    std::string rendered;
+    rendered.reserve(64 + head.length());
+    if (prefix.empty()) {
+        rendered.append("HTTP/1.1 ").append(std::to_string(status)).append(" ")
+                .append(reason_phrase(status)).append("\r\n" COMMON_HEADERS);
+    }
+    rendered.append("Content-Length: ").append(std::to_string(content.length())).append("\r\n");
+    rendered.append(head).append("\r\n");
+    head.swap(rendered);
+}
+
+size_t HttpResponse::size() const {
+    return prefix.length() + head.length() + body().length();
+}
+
+size_t HttpResponse::fill_iovec(iovec* iov, size_t offset) const {
+    std::string_view parts[IOV_COUNT] = {prefix, head, body()};
+    size_t count = 0;
+    for (std::string_view part : parts) {
+        if (offset >= part.length()) {
+            offset -= part.length();
+            continue;
+        }
+        iov[count].iov_base = const_cast<char*>(part.data()) + offset;
+        iov[count].iov_len = part.length() - offset;
+        offset = 0;
+        ++count;
+    }
+    return count;
+}
+
+HttpResponse create_http_error_response(int status_code, const std::string& message) {
+    HttpResponse response(status_code, "{\"status\":\"error\",\"data\":\"" + message + "\"}");
+    response.add_header("Connection", "close");
+    return response;
+}
@@ -0,0 +1,77 @@
+#ifndef HTTP_RESPONSE_H
+#define HTTP_RESPONSE_H
+
+#include <string>
+#include <string_view>
+#include <functional>
+#include <memory>
+#include <sys/uio.h>
+
+struct Connection;
+
+// HTTP 响应：状态行、响应头、响应体分开保存，由事件循环用 sendmsg 一次写出，
+// 响应体不再被拷贝进拼接好的整段字符串
+// 常用状态码的状态行和公共响应头（Content-Type、CORS）是预先渲染好的常量
+class HttpResponse {
+public:
+    // 一个响应最多占用的 iovec 个数
+    static const size_t IOV_COUNT = 3;
+
+    // 响应交给事件循环之后的处理方式
+    enum class Kind {
+        NORMAL,
+        WEBSOCKET,     // 101 之后连接改用 WebSocket 帧
+        EVENT_STREAM,  // 响应头之后持续发送 SSE 事件，不再读取请求
+        DEFERRED       // 暂不回复，请求保持在处理中，之后由 send_response 回复
+    };
+
+    // 在连接所属的事件循环线程中调用：切换协议之后，或登记延迟回复的请求时
+    using ConnectionHandler = std::function<void(const std::shared_ptr<Connection>& conn)>;
+
+    HttpResponse();
+    HttpResponse(int status_code, std::string body);
+
+    // 已编码好的原始数据（如 WebSocket 帧），不带状态行和响应头
+    static HttpResponse raw(std::string data);
+    // 多个连接共享的原始数据（如群消息帧），只保存引用，不复制
+    static HttpResponse raw(std::shared_ptr<const std::string> data);
+    // 101 Switching Protocols：head 为完整的状态行和响应头，发送后连接改用新协议
+    static HttpResponse switching_protocols(std::string head, ConnectionHandler on_upgrade);
+    // text/event-stream 响应，events 为紧跟响应头发送的事件，之后连接只用于推送事件
+    static HttpResponse event_stream(std::string events, ConnectionHandler on_open);
+    // 延迟回复：事件循环不发送任何数据，把连接交给 on_park，由登记方稍后调用 send_response
+    static HttpResponse deferred(ConnectionHandler on_park);
+
+    Kind kind() const;
+    // 是否为共享的原始数据（推送帧）
+    bool is_shared() const;
+    const ConnectionHandler& connection_handler() const;
+
+    int status_code() const;
+    const std::string& body() const;
+
+    // 追加响应头，必须在 finalize() 之前调用
+    void add_header(std::string_view name, std::string_view value);
+    // 生成 Content-Length 和结束空行，之后响应内容不再改变
+    void finalize();
+
+    // 响应总字节数（finalize() 之后有效）
+    size_t size() const;
+    // 跳过已发送的 offset 字节，把剩余数据填入 iov，返回使用的 iovec 个数
+    size_t fill_iovec(iovec* iov, size_t offset) const;
+
+private:
+    int status;
+    std::string_view prefix;  // 预渲染的状态行和公共响应头
+    std::string head;         // 额外响应头；finalize() 后加上 Content-Length 和结束空行
+    std::string content;
+    std::shared_ptr<const std::string> shared_content;  // 设置时代替 content
+    bool finalized;
+    Kind response_kind;
+    ConnectionHandler on_connection;
+};
+
+// 生成不带业务数据的 HTTP 错误响应（用于协议层错误），发送后关闭连接
+HttpResponse create_http_error_response(int status_code, const std::string& message);
+
+#endif // HTTP_RESPONSE_H
@@ -2,32 +2,135 @@
 #include "logger.h"
 #include <iostream>
 #include <signal.h>
+#include <sys/resource.h>
 #include <atomic>
 std::atomic<bool> g_running(true);
+std::atomic<bool> g_upgrade_requested(false);
 Server* g_server = nullptr;
 
 void signal_handler(int signal) {
-    (void)signal;
+    if (signal == SIGUSR2) {
+        g_upgrade_requested = true;
+        return;
+    }
     g_running = false;
 }
 
+void print_usage(const char* program) {
+    std::cerr << "用法: " << program << " [端口] [选项]" << std::endl;
+    std::cerr << "  --io-threads=N    事件循环线程数（默认按 CPU 核数，最多 4）" << std::endl;
+    std::cerr << "  --workers=N       工作线程数（默认 8）" << std::endl;
+    std::cerr << "  --queue-depth=N   请求队列上限，超出时返回 503（默认 1024）" << std::endl;
+    std::cerr << "  --max-body-size=N 请求体上限字节数，超出时返回 413（默认 16MB）" << std::endl;
+    std::cerr << "  --backlog=N       监听队列长度（默认 SOMAXCONN）" << std::endl;
+    std::cerr << "  --reuseport       每个事件循环使用独立的 SO_REUSEPORT 监听 socket" << std::endl;
+    std::cerr << "  --pin-cpus        把事件循环线程绑定到各自的 CPU 核心" << std::endl;
+    std::cerr << "  --io-backend=NAME I/O 后端：epoll 或 io_uring（默认 epoll）" << std::endl;
+    std::cerr << "  --drain-timeout=N 平滑升级时等待处理中请求完成的秒数（默认 30）" << std::endl;
+    std::cerr << "  --db-batch-rows=N   一个事务最多写入的消息数（默认 128）" << std::endl;
+    std::cerr << "  --db-batch-window=N 批量写入消息时等待的毫秒数（默认 2，0 表示不等待）" << std::endl;
+    std::cerr << "  --session-ttl=N   登录会话在最后一次心跳或认证请求后保留的秒数（默认 300）" << std::endl;
+    std::cerr << "  --push-queue-high=N 推送连接发送队列的高水位帧数（默认 256）" << std::endl;
+    std::cerr << "  --push-queue-low=N  溢出丢弃后保留的帧数（默认 64）" << std::endl;
+    std::cerr << "  --push-overflow=P   推送队列溢出策略：drop（丢弃最早的帧）或 disconnect（默认 drop）" << std::endl;
+    std::cerr << "  --check-query-plans 迁移数据库后检查热点查询的执行计划，有全表扫描时以非零状态退出" << std::endl;
+    std::cerr << "向进程发送 SIGUSR2 进行平滑升级：启动新版本并交出监听 socket 后排空连接退出" << std::endl;
+}
+
+// 解析命令行：第一个非选项参数为端口，其余为 --name=value 形式的选项
+bool parse_arguments(int argc, char* argv[], ServerConfig& config) {
+    config.program_args.push_back(argv[0]);
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        // --upgrade-fd 只用于本次启动，不传给升级后的新进程
+        if (arg.rfind("--upgrade-fd=", 0) != 0) {
+            config.program_args.push_back(arg);
+        }
+        if (arg.rfind("--", 0) != 0) {
+            config.port = std::atoi(arg.c_str());
+            continue;
+        }
+        
+        size_t eq = arg.find('=');
+        std::string name = arg.substr(2, eq == std::string::npos ? std::string::npos : eq - 2);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        
+        if (name == "io-threads") {
+            config.io_threads = safe_stoi(value, 0);
+        } else if (name == "workers") {
+            config.worker_threads = safe_stoi(value, config.worker_threads);
+        } else if (name == "queue-depth") {
+            config.queue_depth = safe_stoi(value, config.queue_depth);
+        } else if (name == "max-body-size") {
+            config.max_body_size = safe_stoi(value, config.max_body_size);
+        } else if (name == "backlog") {
+            config.backlog = safe_stoi(value, config.backlog);
+        } else if (name == "reuseport") {
+            config.reuse_port = true;
+        } else if (name == "pin-cpus") {
+            config.pin_cpus = true;
+        } else if (name == "io-backend" && value == "epoll") {
+            config.io_backend = IoBackend::EPOLL;
+        } else if (name == "io-backend" && value == "io_uring") {
+            config.io_backend = IoBackend::IO_URING;
+        } else if (name == "drain-timeout") {
+            config.drain_timeout = safe_stoi(value, config.drain_timeout);
+        } else if (name == "db-batch-rows") {
+            config.db_write_batch.max_rows = std::max(1, safe_stoi(value, config.db_write_batch.max_rows));
+        } else if (name == "db-batch-window") {
+            config.db_write_batch.window_ms = std::max(0, safe_stoi(value, config.db_write_batch.window_ms));
+        } else if (name == "session-ttl") {
+            config.session_ttl = std::max(1, safe_stoi(value, config.session_ttl));
+        } else if (name == "push-queue-high") {
+            config.push_queue.high_watermark = std::max(1, safe_stoi(value, 256));
+        } else if (name == "push-queue-low") {
+            config.push_queue.low_watermark = std::max(0, safe_stoi(value, 64));
+        } else if (name == "push-overflow" && (value == "drop" || value == "disconnect")) {
+            config.push_queue.policy = value == "drop" ? OverflowPolicy::DROP_OLDEST : OverflowPolicy::DISCONNECT;
+        } else if (name == "check-query-plans") {
+            config.check_query_plans = true;
+        } else if (name == "upgrade-fd") {
+            config.upgrade_fd = safe_stoi(value, -1);
+        } else {
+            std::cerr << "未知选项: " << arg << std::endl;
+            return false;
+        }
+    }
+    return config.port > 0;
+}
+
+// 大量长连接需要足够的文件描述符
+void raise_fd_limit() {
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
 int main(int argc, char* argv[]) {
     // 初始化日志系统
     Logger::getInstance().setLogLevel(LogLevel::INFO);
     Logger::getInstance().setLogFile("talkbox.log");
     LOG_INFO("Talkbox 服务器启动中...");
     
-    int port = 8080;
-    
-    if (argc > 1) {
-        port = std::atoi(argv[1]);
+    ServerConfig config;
+    if (!parse_arguments(argc, argv, config)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (config.check_query_plans) {
+        Database db("talkbox.db", 1);
+        return db.check_query_plans() ? 0 : 1;
     }
+    raise_fd_limit();
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
+    signal(SIGUSR2, signal_handler);
     
     try {
-        g_server = new Server(port);
-        LOG_INFO("服务器启动在端口: " + std::to_string(port));
+        g_server = new Server(config);
+        LOG_INFO("服务器启动在端口: " + std::to_string(config.port));
         g_server->run();
     } catch (const std::exception& e) {
         LOG_ERROR("服务器错误: " + std::string(e.what()));
@@ -1,18 +1,24 @@
 #include "message_service.h"
 #include "database.h"
 #include "user_manager.h"
+#include "push_hub.h"
+#include "group_fanout.h"
 #include "common.h"
+#include "arena.h"
+#include "event_loop.h"
 #include <iostream>
 #include <sstream>
+#include <algorithm>
 
-MessageService::MessageService(Database* db, UserManager* user_manager)
-    : db(db), user_manager(user_manager) {
+MessageService::MessageService(Database* db, UserManager* user_manager, PushHub* push_hub,
+                               GroupFanout* group_fanout)
+    : db(db), user_manager(user_manager), push_hub(push_hub), group_fanout(group_fanout) {
 }
 
 MessageService::~MessageService() {
 }
 
-std::string MessageService::send_message(const std::string& body) {
+HttpResponse MessageService::send_message(std::string_view body) {
     std::string username = parse_json_value(body, "username");
     if (username.empty()) {
         return create_json_response("error", "用户名不能为空");
@@ -79,51 +85,16 @@ std::string MessageService::send_message(const std::string& body) {
     }
 }
 
-std::string MessageService::get_messages(const std::string& query_string) {
+HttpResponse MessageService::get_messages(std::string_view query_string) {
     // 解析查询参数
     std::string username;
     int limit = 50;  // 默认每次加载50条
     int before_id = -1;  // 用于无限滚动加载
     
-    if (!query_string.empty()) {
-        // 解析 username
-        size_t pos = query_string.find("username=");
-        if (pos != std::string::npos) {
-            pos += 8; // strlen("username=")
-            size_t end = query_string.find('&', pos);
-            if (end == std::string::npos) {
-                end = query_string.length();
-            }
-            username = query_string.substr(pos, end - pos);
-        }
-        
-        // 解析 limit
-        pos = query_string.find("limit=");
-        if (pos != std::string::npos) {
-            pos += 6; // strlen("limit=")
-            size_t end = query_string.find('&', pos);
-            if (end == std::string::npos) {
-                end = query_string.length();
-            }
-            try {
-                limit = safe_stoi(query_string.substr(pos, end - pos));
-                if (limit <= 0 || limit > 200) limit = 50;  // 限制范围
-            } catch (...) {}
-        }
-        
-        // 解析 before_id
-        pos = query_string.find("before_id=");
-        if (pos != std::string::npos) {
-            pos += 10; // strlen("before_id=")
-            size_t end = query_string.find('&', pos);
-            if (end == std::string::npos) {
-                end = query_string.length();
-            }
-            try {
-                before_id = safe_stoi(query_string.substr(pos, end - pos));
-            } catch (...) {}
-        }
-    }
+    username = get_query_param(query_string, "username");
+    limit = safe_stoi(get_query_param(query_string, "limit"), limit);
+    if (limit <= 0 || limit > 200) limit = 50;  // 限制范围
+    before_id = safe_stoi(get_query_param(query_string, "before_id"), before_id);
     
     if (username.empty()) {
         return create_json_response("error", "用户名不能为空");
@@ -136,59 +107,40 @@ std::string MessageService::get_messages(const std::string& query_string) {
     
     std::vector<Message> messages = db->get_messages(user_id, limit, before_id);
     
-    std::ostringstream json_array;
-    json_array << "[";
+    // 在请求内存区中拼接，最后只把完整的响应体复制一次
+    std::pmr::string json(&request_arena());
+    json.reserve(64 + messages.size() * 256);
+    json.append("{\"status\":\"success\",\"data\":[");
     
     for (size_t i = 0; i < messages.size(); ++i) {
         if (i > 0) {
-            json_array << ",";
-        }
-        
-        // 获取发送者用户名
-        std::string sender_username = db->get_username_by_id(messages[i].sender_id);
-        if (!sender_username.empty()) {
-            messages[i].sender_username = sender_username;
+            json.append(",");
         }
         
-        json_array << "{\"message_id\":" << messages[i].message_id
-                  << ",\"sender_id\":" << messages[i].sender_id
-                  << ",\"sender_username\":\"" << escape_json_string(messages[i].sender_username) << "\""
-                  << ",\"receiver_id\":" << messages[i].receiver_id
-                  << ",\"group_id\":" << messages[i].group_id
-                  << ",\"content\":\"" << escape_json_string(messages[i].content) << "\""
-                  << ",\"type\":\"" << escape_json_string(messages[i].type) << "\""
-                  << ",\"timestamp\":\"" << escape_json_string(messages[i].timestamp) << "\"}";
+        json.append("{\"message_id\":").append(std::to_string(messages[i].message_id))
+            .append(",\"sender_id\":").append(std::to_string(messages[i].sender_id))
+            .append(",\"sender_username\":\"");
+        append_escaped_json(json, messages[i].sender_username);
+        json.append("\",\"receiver_id\":").append(std::to_string(messages[i].receiver_id))
+            .append(",\"group_id\":").append(std::to_string(messages[i].group_id))
+            .append(",\"content\":\"");
+        append_escaped_json(json, messages[i].content);
+        json.append("\",\"type\":\"");
+        append_escaped_json(json, messages[i].type);
+        json.append("\",\"timestamp\":\"");
+        append_escaped_json(json, messages[i].timestamp);
+        json.append("\"}");
     }
     
-    json_array << "]";
-    
     // 返回结果包含 has_more 字段，用于判断是否还有更多消息
-    std::string result = "{\"status\":\"success\",\"data\":" + json_array.str() + 
-                         ",\"has_more\":" + (messages.size() >= (size_t)limit ? "true" : "false") + "}";
-    
-    return "HTTP/1.1 200 OK\r\n"
-           "Content-Type: application/json\r\n"
-           "Content-Length: " + std::to_string(result.length()) + "\r\n"
-           "Connection: close\r\n"
-           "Access-Control-Allow-Origin: *\r\n"
-           "\r\n" + result;
+    json.append("],\"has_more\":").append(messages.size() >= (size_t)limit ? "true" : "false").append("}");
+    
+    return HttpResponse(200, std::string(json));
 }
 
-std::string MessageService::get_contacts(const std::string& query_string) {
+HttpResponse MessageService::get_contacts(std::string_view query_string) {
     // 解析查询参数中的username
-    std::string username = "";
-    if (!query_string.empty()) {
-        std::string search_key = "username=";
-        size_t pos = query_string.find(search_key);
-        if (pos != std::string::npos) {
-            pos += search_key.length();
-            size_t end = query_string.find('&', pos);
-            if (end == std::string::npos) {
-                end = query_string.length();
-            }
-            username = query_string.substr(pos, end - pos);
-        }
-    }
+    std::string username(get_query_param(query_string, "username"));
     
     if (username.empty()) {
         return create_json_response("error", "用户名不能为空");
@@ -223,7 +175,78 @@ std::string MessageService::get_contacts(const std::string& query_string) {
     return create_json_response("success", json_array.str());
 }
 
-std::string MessageService::create_group(const std::string& body) {
+HttpResponse MessageService::get_conversations(std::string_view query_string) {
+    std::string username(get_query_param(query_string, "username"));
+    int limit = safe_stoi(get_query_param(query_string, "limit"), 20);
+    if (limit <= 0 || limit > 100) limit = 20;
+    int before_id = safe_stoi(get_query_param(query_string, "before_id"), -1);
+    
+    if (username.empty()) {
+        return create_json_response("error", "用户名不能为空");
+    }
+    
+    int user_id = user_manager->get_user_id_by_username(username);
+    if (user_id == -1) {
+        return create_json_response("error", "无效的用户名");
+    }
+    
+    std::vector<Conversation> conversations = db->get_conversations(user_id, before_id, limit);
+    
+    std::pmr::string json(&request_arena());
+    json.reserve(64 + conversations.size() * 256);
+    json.append("{\"status\":\"success\",\"data\":[");
+    for (size_t i = 0; i < conversations.size(); ++i) {
+        const Conversation& conversation = conversations[i];
+        if (i > 0) {
+            json.append(",");
+        }
+        json.append("{\"peer_id\":").append(std::to_string(conversation.peer_id))
+            .append(",\"peer_username\":\"");
+        append_escaped_json(json, conversation.peer_username);
+        json.append("\",\"group_id\":").append(std::to_string(conversation.group_id))
+            .append(",\"group_name\":\"");
+        append_escaped_json(json, conversation.group_name);
+        json.append("\",\"last_message_id\":").append(std::to_string(conversation.last_message_id))
+            .append(",\"last_sender_id\":").append(std::to_string(conversation.last_sender_id))
+            .append(",\"preview\":\"");
+        append_escaped_json(json, conversation.preview);
+        json.append("\",\"timestamp\":\"");
+        append_escaped_json(json, conversation.last_timestamp);
+        json.append("\",\"unread_count\":").append(std::to_string(conversation.unread_count))
+            .append("}");
+    }
+    
+    // 下一页以最后一项的 last_message_id 作为 before_id
+    json.append("],\"has_more\":").append(conversations.size() >= (size_t)limit ? "true" : "false").append("}");
+    
+    return HttpResponse(200, std::string(json));
+}
+
+HttpResponse MessageService::mark_read(std::string_view body) {
+    std::string username = parse_json_value(body, "username");
+    int peer_id = safe_stoi(parse_json_value(body, "peer_id"), -1);
+    int group_id = safe_stoi(parse_json_value(body, "group_id"), -1);
+    int up_to_id = safe_stoi(parse_json_value(body, "message_id"), -1);
+    
+    if (username.empty()) {
+        return create_json_response("error", "用户名不能为空");
+    }
+    if ((peer_id == -1) == (group_id == -1)) {
+        return create_json_response("error", "必须指定 peer_id 或 group_id 之一");
+    }
+    
+    int user_id = user_manager->get_user_id_by_username(username);
+    if (user_id == -1) {
+        return create_json_response("error", "无效的用户名");
+    }
+    
+    if (!db->mark_conversation_read(user_id, peer_id, group_id, up_to_id)) {
+        return create_json_response("error", "标记已读失败");
+    }
+    return create_json_response("success", "已标记为已读");
+}
+
+HttpResponse MessageService::create_group(std::string_view body) {
     std::string username = parse_json_value(body, "username");
     if (username.empty()) {
         return create_json_response("error", "用户名不能为空");
@@ -248,13 +271,14 @@ std::string MessageService::create_group(const std::string& body) {
     group.created_time = get_current_timestamp();
     
     if (db->create_group(group)) {
+        group_fanout->join(user_id, group.group_id);
         return create_json_response("success", "群组创建成功");
     } else {
         return create_json_response("error", "群组创建失败");
     }
 }
 
-std::string MessageService::join_group(const std::string& body) {
+HttpResponse MessageService::join_group(std::string_view body) {
     std::string username = parse_json_value(body, "username");
     if (username.empty()) {
         return create_json_response("error", "用户名不能为空");
@@ -280,13 +304,14 @@ std::string MessageService::join_group(const std::string& body) {
     }
     
     if (db->join_group(user_id, group_id)) {
+        group_fanout->join(user_id, group_id);
         return create_json_response("success", "加入群组成功");
     } else {
         return create_json_response("error", "加入群组失败");
     }
 }
 
-std::string MessageService::leave_group(const std::string& body) {
+HttpResponse MessageService::leave_group(std::string_view body) {
     std::string username = parse_json_value(body, "username");
     if (username.empty()) {
         return create_json_response("error", "用户名不能为空");
@@ -312,30 +337,19 @@ std::string MessageService::leave_group(const std::string& body) {
     }
     
     if (db->leave_group(user_id, group_id)) {
+        group_fanout->leave(user_id, group_id);
         return create_json_response("success", "退出群组成功");
     } else {
         return create_json_response("error", "退出群组失败");
     }
 }
 
-std::string MessageService::get_groups(const std::string& query_string) {
+HttpResponse MessageService::get_groups(std::string_view query_string) {
     std::vector<Group> groups;
     int user_id = -1;
     
     // 解析查询参数中的username
-    std::string username = "";
-    if (!query_string.empty()) {
-        std::string search_key = "username=";
-        size_t pos = query_string.find(search_key);
-        if (pos != std::string::npos) {
-            pos += search_key.length();
-            size_t end = query_string.find('&', pos);
-            if (end == std::string::npos) {
-                end = query_string.length();
-            }
-            username = query_string.substr(pos, end - pos);
-        }
-    }
+    std::string username(get_query_param(query_string, "username"));
     
     if (!username.empty()) {
         user_id = user_manager->get_user_id_by_username(username);
@@ -374,55 +388,18 @@ std::string MessageService::get_groups(const std::string& query_string) {
     return create_json_response("success", json_array.str());
 }
 
-std::string MessageService::get_group_messages(const std::string& query_string) {
+HttpResponse MessageService::get_group_messages(std::string_view query_string) {
     // 解析查询参数
     std::string username;
     std::string group_id_str;
     int limit = 50;  // 默认每次加载50条
     int before_id = -1;  // 用于无限滚动加载
     
-    if (!query_string.empty()) {
-        // 解析 username
-        size_t pos = query_string.find("username=");
-        if (pos != std::string::npos) {
-            pos += 8;
-            size_t end = query_string.find('&', pos);
-            if (end == std::string::npos) end = query_string.length();
-            username = query_string.substr(pos, end - pos);
-        }
-        
-        // 解析 group_id
-        pos = query_string.find("group_id=");
-        if (pos != std::string::npos) {
-            pos += 9;
-            size_t end = query_string.find('&', pos);
-            if (end == std::string::npos) end = query_string.length();
-            group_id_str = query_string.substr(pos, end - pos);
-        }
-        
-        // 解析 limit
-        pos = query_string.find("limit=");
-        if (pos != std::string::npos) {
-            pos += 6;
-            size_t end = query_string.find('&', pos);
-            if (end == std::string::npos) end = query_string.length();
-            try {
-                limit = safe_stoi(query_string.substr(pos, end - pos));
-                if (limit <= 0 || limit > 200) limit = 50;
-            } catch (...) {}
-        }
-        
-        // 解析 before_id
-        pos = query_string.find("before_id=");
-        if (pos != std::string::npos) {
-            pos += 10;
-            size_t end = query_string.find('&', pos);
-            if (end == std::string::npos) end = query_string.length();
-            try {
-                before_id = safe_stoi(query_string.substr(pos, end - pos));
-            } catch (...) {}
-        }
-    }
+    username = get_query_param(query_string, "username");
+    group_id_str = get_query_param(query_string, "group_id");
+    limit = safe_stoi(get_query_param(query_string, "limit"), limit);
+    if (limit <= 0 || limit > 200) limit = 50;
+    before_id = safe_stoi(get_query_param(query_string, "before_id"), before_id);
     
     if (username.empty()) {
         return create_json_response("error", "用户名不能为空");
@@ -445,61 +422,210 @@ std::string MessageService::get_group_messages(const std::string& query_string)
     
     std::vector<Message> messages = db->get_group_messages(group_id, limit, before_id);
     
-    std::ostringstream json_array;
-    json_array << "[";
+    // 在请求内存区中拼接，最后只把完整的响应体复制一次
+    std::pmr::string json(&request_arena());
+    json.reserve(64 + messages.size() * 256);
+    json.append("{\"status\":\"success\",\"data\":[");
     
     for (size_t i = 0; i < messages.size(); ++i) {
         if (i > 0) {
-            json_array << ",";
+            json.append(",");
         }
         
-        // 获取发送者用户名
-        std::string sender_username = db->get_username_by_id(messages[i].sender_id);
-        if (!sender_username.empty()) {
-            messages[i].sender_username = sender_username;
+        json.append("{\"message_id\":").append(std::to_string(messages[i].message_id))
+            .append(",\"sender_id\":").append(std::to_string(messages[i].sender_id))
+            .append(",\"sender_username\":\"");
+        append_escaped_json(json, messages[i].sender_username);
+        json.append("\",\"group_id\":").append(std::to_string(messages[i].group_id))
+            .append(",\"content\":\"");
+        append_escaped_json(json, messages[i].content);
+        json.append("\",\"type\":\"");
+        append_escaped_json(json, messages[i].type);
+        json.append("\",\"timestamp\":\"");
+        append_escaped_json(json, messages[i].timestamp);
+        json.append("\"}");
+    }
+    
+    // 返回结果包含 has_more 字段
+    json.append("],\"has_more\":").append(messages.size() >= (size_t)limit ? "true" : "false").append("}");
+    
+    return HttpResponse(200, std::string(json));
+}
+
+HttpResponse MessageService::sync(std::string_view query_string) {
+    std::string username(get_query_param(query_string, "username"));
+    if (username.empty()) {
+        return create_json_response("error", "用户名不能为空");
+    }
+    
+    int user_id = user_manager->get_user_id_by_username(username);
+    if (user_id == -1) {
+        return create_json_response("error", "无效的用户名");
+    }
+    
+    // 游标对客户端不透明，缺省或无法解析时从头同步
+    int cursor = std::max(0, safe_stoi(get_query_param(query_string, "cursor"), 0));
+    int limit = safe_stoi(get_query_param(query_string, "limit"), SYNC_DEFAULT_LIMIT);
+    if (limit <= 0 || limit > SYNC_MAX_LIMIT) limit = SYNC_DEFAULT_LIMIT;
+    
+    SyncChanges changes = db->get_changes_since(user_id, cursor, limit);
+    
+    std::pmr::string json(&request_arena());
+    json.reserve(160 + changes.messages.size() * 256 + changes.contacts.size() * 48);
+    json.append("{\"status\":\"success\",\"data\":{\"cursor\":\"").append(std::to_string(changes.cursor))
+        .append("\",\"has_more\":").append(changes.has_more ? "true" : "false")
+        .append(",\"messages\":[");
+    for (size_t i = 0; i < changes.messages.size(); ++i) {
+        const Message& message = changes.messages[i];
+        if (i > 0) {
+            json.append(",");
         }
-        
-        json_array << "{\"message_id\":" << messages[i].message_id
-                  << ",\"sender_id\":" << messages[i].sender_id
-                  << ",\"sender_username\":\"" << escape_json_string(messages[i].sender_username) << "\""
-                  << ",\"group_id\":" << messages[i].group_id
-                  << ",\"content\":\"" << escape_json_string(messages[i].content) << "\""
-                  << ",\"type\":\"" << escape_json_string(messages[i].type) << "\""
-                  << ",\"timestamp\":\"" << escape_json_string(messages[i].timestamp) << "\"}";
+        json.append("{\"message_id\":").append(std::to_string(message.message_id))
+            .append(",\"sender_id\":").append(std::to_string(message.sender_id))
+            .append(",\"sender_username\":\"");
+        append_escaped_json(json, message.sender_username);
+        json.append("\",\"receiver_id\":").append(std::to_string(message.receiver_id))
+            .append(",\"group_id\":").append(std::to_string(message.group_id))
+            .append(",\"content\":\"");
+        append_escaped_json(json, message.content);
+        json.append("\",\"type\":\"");
+        append_escaped_json(json, message.type);
+        json.append("\",\"timestamp\":\"");
+        append_escaped_json(json, message.timestamp);
+        json.append("\"}");
+    }
+    
+    json.append("],\"groups_joined\":[");
+    for (size_t i = 0; i < changes.groups_joined.size(); ++i) {
+        const Group& group = changes.groups_joined[i];
+        if (i > 0) {
+            json.append(",");
+        }
+        json.append("{\"group_id\":").append(std::to_string(group.group_id)).append(",\"group_name\":\"");
+        append_escaped_json(json, group.group_name);
+        json.append("\",\"description\":\"");
+        append_escaped_json(json, group.description);
+        json.append("\",\"creator_id\":").append(std::to_string(group.creator_id)).append(",\"created_time\":\"");
+        append_escaped_json(json, group.created_time);
+        json.append("\"}");
     }
     
-    json_array << "]";
+    json.append("],\"groups_left\":[");
+    for (size_t i = 0; i < changes.groups_left.size(); ++i) {
+        if (i > 0) {
+            json.append(",");
+        }
+        json.append(std::to_string(changes.groups_left[i]));
+    }
     
-    // 返回结果包含 has_more 字段
-    std::string result = "{\"status\":\"success\",\"data\":" + json_array.str() + 
-                         ",\"has_more\":" + (messages.size() >= (size_t)limit ? "true" : "false") + "}";
-    
-    return "HTTP/1.1 200 OK\r\n"
-           "Content-Type: application/json\r\n"
-           "Content-Length: " + std::to_string(result.length()) + "\r\n"
-           "Connection: close\r\n"
-           "Access-Control-Allow-Origin: *\r\n"
-           "\r\n" + result;
+    json.append("],\"contacts\":[");
+    for (size_t i = 0; i < changes.contacts.size(); ++i) {
+        const User& contact = changes.contacts[i];
+        if (i > 0) {
+            json.append(",");
+        }
+        json.append("{\"user_id\":").append(std::to_string(contact.user_id)).append(",\"username\":\"");
+        append_escaped_json(json, contact.username);
+        json.append("\",\"online\":").append(user_manager->is_user_online(contact.user_id) ? "true" : "false")
+            .append("}");
+    }
+    json.append("]}}");
+    
+    return HttpResponse(200, std::string(json));
 }
 
-void MessageService::broadcast_message(const Message& message) {
-    // 获取在线用户
-    auto& online_users = user_manager->get_online_users();
-    auto& users_mutex = user_manager->get_users_mutex();
+HttpResponse MessageService::get_events(int user_id, std::string_view query_string,
+                                        std::string_view last_event_id, bool stream) {
+    std::string_view since_param = get_query_param(query_string, "since_id");
+    int timeout_ms = safe_stoi(get_query_param(query_string, "timeout"),
+                               PushHub::DEFAULT_POLL_TIMEOUT_MS / 1000) * 1000;
+    timeout_ms = std::max(1000, std::min(timeout_ms, PushHub::MAX_POLL_TIMEOUT_MS));
+    
+    // 没有给出起点时从当前最新的消息开始，不补发历史消息
+    int since_id;
+    if (!last_event_id.empty()) {
+        since_id = safe_stoi(last_event_id, 0);
+    } else if (!since_param.empty()) {
+        since_id = safe_stoi(since_param, 0);
+    } else {
+        since_id = db->get_latest_message_id();
+    }
+    if (since_id < 0) since_id = 0;
+    
+    // 先取事件标记再查询数据库，登记会话时据此发现查询之后才到达的消息
+    uint64_t seen = push_hub->event_mark(user_id);
+    std::vector<Message> messages = db->get_messages_since(user_id, since_id,
+                                                           stream ? EVENTS_REPLAY_LIMIT : EVENTS_BATCH_LIMIT);
     
-    std::lock_guard<std::mutex> lock(users_mutex);
+    if (stream) {
+        std::string events;
+        for (const Message& message : messages) {
+            events.append(format_sse_event(make_message_event(message)));
+        }
+        PushHub* hub = push_hub;
+        if (messages.size() == (size_t)EVENTS_REPLAY_LIMIT) {
+            // 未收到的消息太多：发送完这一批后结束事件流，客户端带最后的 Last-Event-ID 重连继续补齐
+            return HttpResponse::event_stream(std::move(events), [](const ConnectionPtr& conn) {
+                conn->loop->end_stream(conn);
+            });
+        }
+        return HttpResponse::event_stream(std::move(events), [hub, user_id, seen](const ConnectionPtr& conn) {
+            hub->add_event_stream(user_id, conn, seen);
+        });
+    }
+    
+    if (messages.empty()) {
+        // 不占用工作线程：请求交还给事件循环挂起，有新消息或超时后由 PushHub 回复
+        PushHub* hub = push_hub;
+        return HttpResponse::deferred([hub, user_id, since_id, seen, timeout_ms](const ConnectionPtr& conn) {
+            hub->park(user_id, conn, since_id, seen, timeout_ms);
+        });
+    }
+    
+    std::pmr::string json(&request_arena());
+    json.reserve(64 + messages.size() * 256);
+    json.append("{\"status\":\"success\",\"data\":[");
+    for (size_t i = 0; i < messages.size(); ++i) {
+        if (i > 0) {
+            json.append(",");
+        }
+        json.append(format_event_json(make_message_event(messages[i])));
+    }
+    json.append("],\"last_id\":").append(std::to_string(messages.back().message_id)).append("}");
+    
+    return HttpResponse(200, std::string(json));
+}
+
+PushEvent MessageService::make_message_event(const Message& message) {
+    // 从数据库读出的消息已带有发送者用户名
+    std::string sender_username = message.sender_username.empty()
+        ? user_manager->get_username_by_id(message.sender_id) : message.sender_username;
+    PushEvent event;
+    event.type = "message";
+    event.id = message.message_id;
+    event.data.reserve(256 + message.content.length());
+    event.data.append("{\"message_id\":").append(std::to_string(message.message_id))
+        .append(",\"sender_id\":").append(std::to_string(message.sender_id))
+        .append(",\"sender_username\":\"").append(escape_json_string(sender_username))
+        .append("\",\"receiver_id\":").append(std::to_string(message.receiver_id))
+        .append(",\"group_id\":").append(std::to_string(message.group_id))
+        .append(",\"content\":\"").append(escape_json_string(message.content))
+        .append("\",\"type\":\"").append(escape_json_string(message.type))
+        .append("\",\"timestamp\":\"").append(escape_json_string(message.timestamp))
+        .append("\"}");
+    return event;
+}
+
+void MessageService::broadcast_message(const Message& message) {
+    // 即使当前没有推送会话也要经过 PushHub：事件计数用于发现与挂起请求之间的竞争
+    PushEvent event = make_message_event(message);
     
     // 私聊消息
     if (message.group_id == -1) {
-        auto it = online_users.find(message.receiver_id);
-        if (it != online_users.end() && it->second.online) {
-            std::string notification = "新消息: " + message.content;
-            // 可以在这里实现实时推送
-        }
+        push_hub->push(message.receiver_id, event);
     }
-    // 群聊消息
+    // 群聊消息：推送给除发送者外的所有在线成员
     else {
-        // 获取群组所有成员并推送消息
-        // 这里可以扩展实现实时推送功能
+        group_fanout->publish(message.group_id, message.sender_id, event);
     }
 }
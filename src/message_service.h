@@ -9,30 +9,57 @@
 // 前向声明
 class Database;
 class UserManager;
+class PushHub;
+class GroupFanout;
+struct PushEvent;
 
 class MessageService {
 public:
-    MessageService(Database* db, UserManager* user_manager);
+    MessageService(Database* db, UserManager* user_manager, PushHub* push_hub, GroupFanout* group_fanout);
     ~MessageService();
     
     // 消息处理API
-    std::string send_message(const std::string& body);
-    std::string get_messages(const std::string& query_string);
-    std::string get_contacts(const std::string& query_string);
+    HttpResponse send_message(std::string_view body);
+    HttpResponse get_messages(std::string_view query_string);
+    HttpResponse get_contacts(std::string_view query_string);
+    // 会话列表（含未读数），按最后一条消息倒序分页
+    HttpResponse get_conversations(std::string_view query_string);
+    HttpResponse mark_read(std::string_view body);
     
     // 群组消息API
-    std::string create_group(const std::string& body);
-    std::string join_group(const std::string& body);
-    std::string leave_group(const std::string& body);
-    std::string get_groups(const std::string& query_string);
-    std::string get_group_messages(const std::string& query_string);
+    HttpResponse create_group(std::string_view body);
+    HttpResponse join_group(std::string_view body);
+    HttpResponse leave_group(std::string_view body);
+    HttpResponse get_groups(std::string_view query_string);
+    HttpResponse get_group_messages(std::string_view query_string);
+    
+    // 增量同步API：返回 cursor 之后的消息、群组成员关系和联系人变更以及新的游标
+    HttpResponse sync(std::string_view query_string);
+    
+    // 实时事件API：返回 since_id 之后的新消息，没有新消息时挂起请求直到有消息或超时
+    // stream 为 true 时改为 SSE 事件流；last_event_id 非空时代替 since_id（SSE 重连）；
+    // 两者都没有时从当前最新的消息开始，只等待之后的新消息
+    HttpResponse get_events(int user_id, std::string_view query_string,
+                            std::string_view last_event_id, bool stream);
     
 private:
     Database* db;
     UserManager* user_manager;
+    PushHub* push_hub;
+    GroupFanout* group_fanout;
+    
+    // 单次从数据库读取的事件数上限
+    static const int EVENTS_BATCH_LIMIT = 100;
+    // SSE 连接建立时补发的消息数上限，超出时发送完这些后结束事件流，客户端带 Last-Event-ID 重连继续
+    static const int EVENTS_REPLAY_LIMIT = 5 * EVENTS_BATCH_LIMIT;
+    // 单次同步读取的变更数上限
+    static const int SYNC_DEFAULT_LIMIT = 500;
+    static const int SYNC_MAX_LIMIT = 1000;
     
     // 工具函数
+    // 把新消息推送给接收者（私聊）或除发送者外的群成员的所有推送会话
     void broadcast_message(const Message& message);
+    PushEvent make_message_event(const Message& message);
 };
 
 #endif // MESSAGE_SERVICE_H
@@ -0,0 +1,288 @@
+#include "push_hub.h"
+#include "event_loop.h"
+#include "websocket.h"
+#include "logger.h"
+#include <algorithm>
+
+std::string format_event_json(const PushEvent& event) {
+    std::string json;
+    json.reserve(32 + event.type.length() + event.data.length());
+    json.append("{\"event\":\"").append(event.type).append("\",\"data\":").append(event.data).append("}");
+    return json;
+}
+
+std::string format_sse_event(const PushEvent& event) {
+    std::string text;
+    text.reserve(32 + event.type.length() + event.data.length());
+    if (event.id > 0) {
+        text.append("id: ").append(std::to_string(event.id)).append("\n");
+    }
+    // data 是单行 JSON，不需要拆成多个 data 字段
+    text.append("event: ").append(event.type).append("\ndata: ").append(event.data).append("\n\n");
+    return text;
+}
+
+PushHub::PushHub() : event_sequence(0) {
+}
+
+PushHub::~PushHub() {
+}
+
+void PushHub::add(int user_id, Session session) {
+    user_by_session[session.conn.get()] = user_id;
+    sessions_by_user[user_id].push_back(std::move(session));
+}
+
+void PushHub::add_session(int user_id, const ConnectionPtr& conn) {
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    add(user_id, Session{conn, SessionKind::WEBSOCKET, 0, {}});
+    LOG_DEBUG("WebSocket 会话建立，用户ID: " + std::to_string(user_id) + "，fd: " + std::to_string(conn->fd));
+}
+
+void PushHub::add_event_stream(int user_id, const ConnectionPtr& conn, uint64_t seen) {
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex);
+        auto it = event_marks.find(user_id);
+        if ((it == event_marks.end() ? 0 : it->second.sequence) == seen) {
+            auto next_heartbeat = std::chrono::steady_clock::now() + std::chrono::milliseconds(HEARTBEAT_INTERVAL_MS);
+            add(user_id, Session{conn, SessionKind::EVENT_STREAM, 0, next_heartbeat});
+            LOG_DEBUG("SSE 会话建立，用户ID: " + std::to_string(user_id) + "，fd: " + std::to_string(conn->fd));
+            return;
+        }
+    }
+    conn->loop->end_stream(conn);
+}
+
+void PushHub::park(int user_id, const ConnectionPtr& conn, int since_id, uint64_t seen, int timeout_ms) {
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex);
+        auto it = event_marks.find(user_id);
+        if ((it == event_marks.end() ? 0 : it->second.sequence) == seen) {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+            add(user_id, Session{conn, SessionKind::LONG_POLL, since_id, deadline});
+            return;
+        }
+    }
+    reply(conn, std::string(), since_id);
+}
+
+void PushHub::remove_session(const ConnectionPtr& conn) {
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    auto it = user_by_session.find(conn.get());
+    if (it == user_by_session.end()) {
+        return;
+    }
+    auto user_it = sessions_by_user.find(it->second);
+    if (user_it != sessions_by_user.end()) {
+        auto& sessions = user_it->second;
+        sessions.erase(std::remove_if(sessions.begin(), sessions.end(),
+                                      [&conn](const Session& s) { return s.conn == conn; }),
+                       sessions.end());
+        if (sessions.empty()) {
+            sessions_by_user.erase(user_it);
+        }
+    }
+    user_by_session.erase(it);
+}
+
+size_t PushHub::push(int user_id, const PushEvent& event) {
+    return push(std::vector<int>{user_id}, event);
+}
+
+size_t PushHub::push(const std::vector<int>& user_ids, const PushEvent& event) {
+    std::vector<Session> targets;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex);
+        EventMark mark{++event_sequence, std::chrono::steady_clock::now()};
+        for (int user_id : user_ids) {
+            take_targets(user_id, mark, targets);
+        }
+    }
+    if (targets.empty()) {
+        return 0;
+    }
+
+    // 每种格式只编码一次，发送在各连接所属的事件循环线程中进行
+    std::string json = format_event_json(event);
+    std::vector<ConnectionPtr> websockets;
+    std::vector<ConnectionPtr> event_streams;
+    for (const auto& session : targets) {
+        switch (session.kind) {
+            case SessionKind::WEBSOCKET:
+                websockets.push_back(session.conn);
+                break;
+            case SessionKind::EVENT_STREAM:
+                event_streams.push_back(session.conn);
+                break;
+            case SessionKind::LONG_POLL:
+                // 消息事件只用来唤醒：各工作线程的推送不按消息ID排序，直接回复这一条并把游标移到
+                // event.id 可能跳过ID更小、稍后才推送的消息。回复空结果并保留原游标，
+                // 客户端随即重新请求，从数据库按顺序取回。没有ID的事件不影响游标，照常附带
+                reply(session.conn, event.id > 0 ? std::string() : json, session.since_id);
+                break;
+        }
+    }
+    if (!websockets.empty()) {
+        send_batched(websockets, std::make_shared<const std::string>(
+            encode_websocket_frame(WebSocketOpcode::TEXT, json)));
+    }
+    if (!event_streams.empty()) {
+        send_batched(event_streams, std::make_shared<const std::string>(format_sse_event(event)));
+    }
+    return targets.size();
+}
+
+void PushHub::take_targets(int user_id, const EventMark& mark, std::vector<Session>& targets) {
+    event_marks[user_id] = mark;
+    auto it = sessions_by_user.find(user_id);
+    if (it == sessions_by_user.end()) {
+        return;
+    }
+    // 长轮询请求收到一个事件就回复，随即移除
+    auto& sessions = it->second;
+    for (auto s = sessions.begin(); s != sessions.end();) {
+        targets.push_back(*s);
+        if (s->kind == SessionKind::LONG_POLL) {
+            user_by_session.erase(s->conn.get());
+            s = sessions.erase(s);
+        } else {
+            ++s;
+        }
+    }
+    if (sessions.empty()) {
+        sessions_by_user.erase(it);
+    }
+}
+
+void PushHub::send_batched(const std::vector<ConnectionPtr>& conns,
+                           const std::shared_ptr<const std::string>& data) {
+    std::unordered_map<EventLoop*, std::vector<ConnectionPtr>> batches;
+    for (const auto& conn : conns) {
+        auto& batch = batches[conn->loop];
+        batch.push_back(conn);
+        if (batch.size() == FANOUT_BATCH_SIZE) {
+            conn->loop->send_frames(std::move(batch), data);
+            batch.clear();
+        }
+    }
+    for (auto& pair : batches) {
+        if (!pair.second.empty()) {
+            pair.first->send_frames(std::move(pair.second), data);
+        }
+    }
+}
+
+uint64_t PushHub::event_mark(int user_id) const {
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    auto it = event_marks.find(user_id);
+    return it == event_marks.end() ? 0 : it->second.sequence;
+}
+
+bool PushHub::has_session(int user_id) const {
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    return sessions_by_user.find(user_id) != sessions_by_user.end();
+}
+
+void PushHub::expire(std::chrono::steady_clock::time_point now) {
+    std::vector<Session> expired;
+    std::vector<ConnectionPtr> heartbeats;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex);
+        for (auto it = sessions_by_user.begin(); it != sessions_by_user.end();) {
+            auto& sessions = it->second;
+            for (auto s = sessions.begin(); s != sessions.end();) {
+                if (s->kind == SessionKind::LONG_POLL && s->deadline <= now) {
+                    expired.push_back(std::move(*s));
+                    user_by_session.erase(expired.back().conn.get());
+                    s = sessions.erase(s);
+                    continue;
+                }
+                if (s->kind == SessionKind::EVENT_STREAM && s->deadline <= now) {
+                    heartbeats.push_back(s->conn);
+                    s->deadline = now + std::chrono::milliseconds(HEARTBEAT_INTERVAL_MS);
+                }
+                ++s;
+            }
+            it = sessions.empty() ? sessions_by_user.erase(it) : std::next(it);
+        }
+
+        // 清理长时间没有新事件的标记。序号不会重复，标记被清理后读到的 0
+        // 不会与清理前记下的 seen 相等；除非请求从查询到登记会话超过 EVENT_MARK_TTL_MS，
+        // 否则只可能多一次空回复，不会漏掉事件
+        if (now >= next_mark_cleanup) {
+            auto stale = now - std::chrono::milliseconds(EVENT_MARK_TTL_MS);
+            for (auto it = event_marks.begin(); it != event_marks.end();) {
+                it = it->second.time < stale ? event_marks.erase(it) : std::next(it);
+            }
+            next_mark_cleanup = now + std::chrono::milliseconds(EVENT_MARK_TTL_MS / 6);
+        }
+    }
+
+    for (const auto& session : expired) {
+        reply(session.conn, std::string(), session.since_id);
+    }
+    if (!heartbeats.empty()) {
+        send_batched(heartbeats, std::make_shared<const std::string>(": ping\n\n"));
+    }
+}
+
+void PushHub::release_waiters() {
+    std::vector<Session> waiters;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex);
+        for (auto it = sessions_by_user.begin(); it != sessions_by_user.end();) {
+            auto& sessions = it->second;
+            for (auto s = sessions.begin(); s != sessions.end();) {
+                if (s->kind == SessionKind::LONG_POLL) {
+                    waiters.push_back(std::move(*s));
+                    user_by_session.erase(waiters.back().conn.get());
+                    s = sessions.erase(s);
+                } else {
+                    ++s;
+                }
+            }
+            it = sessions.empty() ? sessions_by_user.erase(it) : std::next(it);
+        }
+    }
+
+    for (const auto& session : waiters) {
+        reply(session.conn, std::string(), session.since_id);
+    }
+}
+
+void PushHub::reply(const ConnectionPtr& conn, const std::string& events, int last_id) {
+    std::string body;
+    body.reserve(64 + events.length());
+    body.append("{\"status\":\"success\",\"data\":[").append(events)
+        .append("],\"last_id\":").append(std::to_string(last_id)).append("}");
+    conn->loop->send_response(conn, HttpResponse(200, std::move(body)));
+}
+
+std::string PushHub::queue_stats_json() const {
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    std::string json = "[";
+    for (const auto& pair : sessions_by_user) {
+        for (const auto& session : pair.second) {
+            if (session.kind == SessionKind::LONG_POLL) {
+                continue;
+            }
+            const PushQueueStats& stats = session.conn->push_stats;
+            if (json.length() > 1) {
+                json.append(",");
+            }
+            json.append("{\"kind\":\"").append(session.kind == SessionKind::WEBSOCKET ? "websocket" : "sse")
+                .append("\",\"queue_depth\":").append(std::to_string(stats.depth.load()))
+                .append(",\"peak_depth\":").append(std::to_string(stats.peak_depth.load()))
+                .append(",\"dropped\":").append(std::to_string(stats.dropped.load()))
+                .append(",\"overflows\":").append(std::to_string(stats.overflows.load()))
+                .append("}");
+        }
+    }
+    json.append("]");
+    return json;
+}
+
+size_t PushHub::session_count() const {
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    return user_by_session.size();
+}
@@ -0,0 +1,106 @@
+#ifndef PUSH_HUB_H
+#define PUSH_HUB_H
+
+#include "connection.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <chrono>
+
+// 推送给客户端的一条事件
+struct PushEvent {
+    std::string type;  // 事件类型，如 "message"
+    int id;            // 消息ID，用作 SSE 的 id 和长轮询的 last_id；0 表示没有
+    std::string data;  // 事件内容（JSON 对象）
+};
+
+// {"event":type,"data":data}，用于 WebSocket 帧和长轮询结果
+std::string format_event_json(const PushEvent& event);
+// SSE 格式的事件（id / event / data 字段和结束空行）
+std::string format_sse_event(const PushEvent& event);
+
+// 客户端接收事件的方式
+enum class SessionKind {
+    WEBSOCKET,     // WebSocket 文本帧
+    EVENT_STREAM,  // SSE 事件流
+    LONG_POLL      // 挂起的 /api/events 请求，收到一个事件或超时后回复（新消息只唤醒，不附带内容）
+};
+
+// 实时推送：记录每个用户当前的推送会话，向用户的所有会话推送事件
+// 会话在事件循环线程中加入，连接关闭时移除；推送可以来自任意工作线程
+class PushHub {
+public:
+    // 长轮询默认和最长的等待时间
+    static const int DEFAULT_POLL_TIMEOUT_MS = 25000;
+    static const int MAX_POLL_TIMEOUT_MS = 60000;
+    // SSE 连接空闲多久发送一次心跳注释，防止被中间代理断开
+    static const int HEARTBEAT_INTERVAL_MS = 15000;
+    // 一次投递给事件循环的连接数上限，大群组的推送分成多个任务，
+    // 事件循环在批次之间可以处理其他连接的读写
+    static const size_t FANOUT_BATCH_SIZE = 256;
+    // 事件标记在最后一个事件之后保留的时间，远大于一个请求查询数据库到登记会话的间隔
+    static const int EVENT_MARK_TTL_MS = 60000;
+
+    PushHub();
+    ~PushHub();
+
+    void add_session(int user_id, const ConnectionPtr& conn);
+    // 登记 SSE 连接；seen 为查询历史事件之前的 event_mark()，
+    // 期间又有新事件时结束事件流，客户端带 Last-Event-ID 重连后从数据库补齐
+    void add_event_stream(int user_id, const ConnectionPtr& conn, uint64_t seen);
+    // 挂起长轮询请求，timeout_ms 内没有事件时回复空结果；
+    // seen 的含义同上，期间又有新事件时立即回复空结果，让客户端重新拉取
+    void park(int user_id, const ConnectionPtr& conn, int since_id, uint64_t seen, int timeout_ms);
+    void remove_session(const ConnectionPtr& conn);
+
+    // 把事件推送给用户的所有会话，返回推送的会话数
+    size_t push(int user_id, const PushEvent& event);
+    // 把同一事件推送给多个用户：事件只编码一次，数据在所有连接间共享
+    size_t push(const std::vector<int>& user_ids, const PushEvent& event);
+    // 用户最近一个事件的序号（全局递增，不会重复），没有或已清理时为 0
+    uint64_t event_mark(int user_id) const;
+    // 用户是否还有推送会话（WebSocket、SSE 或挂起的长轮询）
+    bool has_session(int user_id) const;
+
+    // 回复已超时的长轮询请求，并向空闲的 SSE 连接发送心跳（由服务器主线程定期调用）
+    void expire(std::chrono::steady_clock::time_point now);
+    // 立即以空结果回复所有长轮询请求（停止服务前调用）
+    void release_waiters();
+
+    size_t session_count() const;
+    // WebSocket / SSE 会话的发送队列统计（JSON 数组：会话类型、队列深度、丢弃数等，不含用户ID和 fd）
+    std::string queue_stats_json() const;
+
+private:
+    struct Session {
+        ConnectionPtr conn;
+        SessionKind kind;
+        int since_id;                                    // 长轮询请求的 since_id
+        std::chrono::steady_clock::time_point deadline;  // 长轮询超时或 SSE 下一次心跳的时间
+    };
+
+    struct EventMark {
+        uint64_t sequence;                           // 全局递增的事件序号
+        std::chrono::steady_clock::time_point time;  // 事件推送的时间
+    };
+
+    mutable std::mutex sessions_mutex;
+    std::unordered_map<int, std::vector<Session>> sessions_by_user;
+    std::unordered_map<Connection*, int> user_by_session;
+    // 每个用户最近一个事件的标记，超过 EVENT_MARK_TTL_MS 没有新事件时清理
+    std::unordered_map<int, EventMark> event_marks;
+    uint64_t event_sequence;
+    std::chrono::steady_clock::time_point next_mark_cleanup;
+
+    void add(int user_id, Session session);
+    // 调用方持有 sessions_mutex：更新用户的事件标记并取出其会话，长轮询会话随即移除
+    void take_targets(int user_id, const EventMark& mark, std::vector<Session>& targets);
+    // 按事件循环分批发送共享数据
+    static void send_batched(const std::vector<ConnectionPtr>& conns,
+                             const std::shared_ptr<const std::string>& data);
+    // 以 events 为内容回复长轮询请求
+    static void reply(const ConnectionPtr& conn, const std::string& events, int last_id);
+};
+
+#endif // PUSH_HUB_H
@@ -0,0 +1,141 @@
+#include "router.h"
+#include <stdexcept>
+
+namespace {
+
+// 取出 path 中从 pos 开始的下一个路径段，pos 移到段末尾
+std::string_view next_segment(std::string_view path, size_t& pos) {
+    if (pos < path.length() && path[pos] == '/') {
+        ++pos;
+    }
+    size_t end = path.find('/', pos);
+    if (end == std::string_view::npos) {
+        end = path.length();
+    }
+    std::string_view segment = path.substr(pos, end - pos);
+    pos = end;
+    return segment;
+}
+
+bool is_param_segment(std::string_view segment) {
+    return segment.length() > 2 && segment.front() == '{' && segment.back() == '}';
+}
+
+}  // namespace
+
+std::string_view RouteParams::get(std::string_view name) const {
+    for (size_t i = 0; i < count; ++i) {
+        if (names[i] == name) {
+            return values[i];
+        }
+    }
+    return {};
+}
+
+void Route::record(uint64_t latency_us) {
+    request_count.fetch_add(1, std::memory_order_relaxed);
+    total_latency_us.fetch_add(latency_us, std::memory_order_relaxed);
+    uint64_t current = max_latency_us.load(std::memory_order_relaxed);
+    while (latency_us > current &&
+           !max_latency_us.compare_exchange_weak(current, latency_us, std::memory_order_relaxed)) {
+    }
+}
+
+Router::Router() {
+}
+
+Router::~Router() {
+}
+
+void Router::add(std::string_view method, std::string_view pattern, bool requires_auth, Route::Handler handler) {
+    auto route = std::make_unique<Route>();
+    route->method = std::string(method);
+    route->pattern = std::string(pattern);
+    route->requires_auth = requires_auth;
+    route->handler = std::move(handler);
+    Route* r = route.get();
+    route_list.push_back(std::move(route));
+
+    // 下面的视图都指向 r->pattern，Route 由 route_list 持有，地址不变
+    std::string_view stored = r->pattern;
+    if (stored.find('{') == std::string_view::npos) {
+        auto& routes = static_routes[stored];
+        if (find_method(routes, r->method)) {
+            throw std::runtime_error("重复注册路由: " + r->method + " " + r->pattern);
+        }
+        routes.push_back(r);
+        return;
+    }
+
+    TrieNode* node = &trie_root;
+    size_t param_count = 0;
+    size_t pos = 0;
+    while (pos < stored.length()) {
+        std::string_view segment = next_segment(stored, pos);
+        if (is_param_segment(segment)) {
+            if (++param_count > MAX_ROUTE_PARAMS) {
+                throw std::runtime_error("路由参数过多: " + r->pattern);
+            }
+            if (!node->param_child) {
+                node->param_child = std::make_unique<TrieNode>();
+                node->param_child->param_name = segment.substr(1, segment.length() - 2);
+            }
+            node = node->param_child.get();
+        } else {
+            auto& child = node->children[segment];
+            if (!child) {
+                child = std::make_unique<TrieNode>();
+            }
+            node = child.get();
+        }
+    }
+    if (find_method(node->routes, r->method)) {
+        throw std::runtime_error("重复注册路由: " + r->method + " " + r->pattern);
+    }
+    node->routes.push_back(r);
+}
+
+Route* Router::find_method(const std::vector<Route*>& routes, std::string_view method) {
+    for (Route* route : routes) {
+        if (route->method == method) {
+            return route;
+        }
+    }
+    return nullptr;
+}
+
+Route* Router::match(std::string_view method, std::string_view path, RouteParams& params) const {
+    params.count = 0;
+
+    auto it = static_routes.find(path);
+    if (it != static_routes.end()) {
+        return find_method(it->second, method);
+    }
+
+    // 逐段匹配，字面段优先于参数段；参数值不能为空
+    const TrieNode* node = &trie_root;
+    size_t pos = 0;
+    while (node && pos < path.length()) {
+        std::string_view segment = next_segment(path, pos);
+        auto child = node->children.find(segment);
+        if (child != node->children.end()) {
+            node = child->second.get();
+        } else if (node->param_child && !segment.empty()) {
+            node = node->param_child.get();
+            params.names[params.count] = node->param_name;
+            params.values[params.count] = segment;
+            ++params.count;
+        } else {
+            node = nullptr;
+        }
+    }
+    if (!node || node->routes.empty()) {
+        params.count = 0;
+        return nullptr;
+    }
+    return find_method(node->routes, method);
+}
+
+const std::vector<std::unique_ptr<Route>>& Router::routes() const {
+    return route_list;
+}
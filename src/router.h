@@ -0,0 +1,81 @@
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include "http_parser.h"
+#include "http_response.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <functional>
+#include <atomic>
+
+// 单个路由最多的路径参数个数
+const size_t MAX_ROUTE_PARAMS = 4;
+
+// 路径参数（如 /api/post/{id} 中的 id），值是指向请求路径的视图
+struct RouteParams {
+    std::string_view names[MAX_ROUTE_PARAMS];
+    std::string_view values[MAX_ROUTE_PARAMS];
+    size_t count = 0;
+
+    // 按名称取参数值，不存在时返回空视图
+    std::string_view get(std::string_view name) const;
+};
+
+// 传给路由处理函数的请求上下文
+struct RequestContext {
+    const HttpRequest& request;
+    const RouteParams& params;
+    int client_fd;
+};
+
+struct Route {
+    using Handler = std::function<HttpResponse(const RequestContext& ctx)>;
+
+    std::string method;
+    std::string pattern;
+    bool requires_auth;
+    Handler handler;
+
+    // 路由统计
+    std::atomic<uint64_t> request_count{0};
+    std::atomic<uint64_t> total_latency_us{0};
+    std::atomic<uint64_t> max_latency_us{0};
+
+    void record(uint64_t latency_us);
+};
+
+// 路由表：启动时注册，运行期只读，可被多个工作线程并发查找
+// 静态路径通过哈希表 O(1) 匹配；带参数的路径（{name} 段）按路径段组成的前缀树匹配
+class Router {
+public:
+    Router();
+    ~Router();
+
+    // 注册路由，pattern 形如 "/api/get_posts" 或 "/api/post/{id}"
+    void add(std::string_view method, std::string_view pattern, bool requires_auth, Route::Handler handler);
+
+    // 查找与请求匹配的路由，未找到时返回 nullptr
+    Route* match(std::string_view method, std::string_view path, RouteParams& params) const;
+
+    const std::vector<std::unique_ptr<Route>>& routes() const;
+
+private:
+    struct TrieNode {
+        std::unordered_map<std::string_view, std::unique_ptr<TrieNode>> children;
+        std::unique_ptr<TrieNode> param_child;  // {name} 段
+        std::string_view param_name;
+        std::vector<Route*> routes;             // 在此结束的路由（按方法区分）
+    };
+
+    std::vector<std::unique_ptr<Route>> route_list;
+    // 键是指向 Route::pattern 的视图
+    std::unordered_map<std::string_view, std::vector<Route*>> static_routes;
+    TrieNode trie_root;
+
+    static Route* find_method(const std::vector<Route*>& routes, std::string_view method);
+};
+
+#endif // ROUTER_H
@@ -2,283 +2,545 @@
 #include "database.h"
 #include "common.h"
 #include "logger.h"
+#include "event_loop.h"
+#include "thread_pool.h"
+#include "http_parser.h"
+#include "router.h"
+#include "arena.h"
+#include "socket_handoff.h"
+#include "websocket.h"
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
 #include <iostream>
 #include <sstream>
+#include <algorithm>
+#include <chrono>
 
-Server::Server(int port) : server_fd(-1), port(port) {
+namespace {
+const int UPGRADE_READY_TIMEOUT_MS = 10000;  // 等待新进程完成初始化的时间
+// 排空开始后空闲连接的宽限时间：活跃的客户端在此期间会发出下一个请求，
+// 随响应收到 Connection: close 后有序地重连，而不是在发送途中被断开
+const int IDLE_DRAIN_GRACE_MS = 1000;
+}
+
+Server::Server(const ServerConfig& config)
+    : port(config.port), config(config), next_loop(0) {
     LOG_INFO("正在初始化服务器，端口: " + std::to_string(port));
     
-    // 初始化数据库
-    db = std::make_unique<Database>("talkbox.db");
+    // 初始化数据库：每个工作线程最多同时使用一个读连接
+    db = std::make_unique<Database>("talkbox.db", config.worker_threads, config.db_write_batch);
     
     // 初始化各个服务模块
-    user_manager = std::make_unique<UserManager>(db.get());
-    message_service = std::make_unique<MessageService>(db.get(), user_manager.get());
+    push_hub = std::make_unique<PushHub>();
+    group_fanout = std::make_unique<GroupFanout>(push_hub.get());
+    user_manager = std::make_unique<UserManager>(db.get(), group_fanout.get(), push_hub.get());
+    user_manager->set_session_ttl(config.session_ttl);
+    message_service = std::make_unique<MessageService>(db.get(), user_manager.get(), push_hub.get(),
+                                                       group_fanout.get());
     forum_service = std::make_unique<ForumService>(db.get(), user_manager.get());
     file_manager = std::make_unique<FileManager>("uploads", user_manager.get());
     
     // 设置服务器
+    setup_routes();
+    setup_event_loops();
     setup_server();
     LOG_INFO("服务器初始化完成");
 }
 
 Server::~Server() {
-    if (server_fd != -1) {
-        close(server_fd);
+    // 先回收工作线程，它们可能仍在向事件循环投递响应
+    worker_pool.reset();
+    loops.clear();
+    for (int fd : listen_fds) {
+        close(fd);
     }
 }
 
-void Server::setup_server() {
-    server_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_fd == -1) {
+int Server::create_listen_socket(bool reuse_port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
         throw std::runtime_error("创建socket失败");
     }
     
     int opt = 1;
-    setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if (reuse_port && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) == -1) {
+        close(fd);
+        throw std::runtime_error("设置SO_REUSEPORT失败");
+    }
     
     sockaddr_in server_addr{};
     server_addr.sin_family = AF_INET;
     server_addr.sin_addr.s_addr = INADDR_ANY;
     server_addr.sin_port = htons(port);
     
-    if (bind(server_fd, (sockaddr*)&server_addr, sizeof(server_addr)) == -1) {
-        close(server_fd);
-        server_fd = -1;
+    if (bind(fd, (sockaddr*)&server_addr, sizeof(server_addr)) == -1) {
+        close(fd);
         throw std::runtime_error("绑定端口失败");
     }
     
-    if (listen(server_fd, 10) == -1) {
-        close(server_fd);
-        server_fd = -1;
+    if (listen(fd, config.backlog) == -1) {
+        close(fd);
         throw std::runtime_error("监听失败");
     }
+    return fd;
 }
 
-void Server::run() {
-    LOG_INFO("服务器已启动，监听端口: " + std::to_string(port));
+void Server::setup_server() {
+    // 平滑升级启动时沿用旧进程的监听 socket，不足的部分再新建
+    std::vector<int> inherited;
+    if (config.upgrade_fd != -1) {
+        inherited = receive_listeners(config.upgrade_fd);
+        LOG_INFO("从旧进程接收到 " + std::to_string(inherited.size()) + " 个监听socket");
+    }
+    auto next_listen_socket = [this, &inherited](bool reuse_port) {
+        if (inherited.empty()) {
+            return create_listen_socket(reuse_port);
+        }
+        int fd = inherited.front();
+        inherited.erase(inherited.begin());
+        return fd;
+    };
     
-    while (g_running) {
-        sockaddr_in client_addr{};
-        socklen_t client_len = sizeof(client_addr);
-        
-        int client_fd = accept(server_fd, (sockaddr*)&client_addr, &client_len);
-        if (client_fd == -1) {
-            if (!g_running) break;
-            continue;
+    if (config.reuse_port) {
+        // 每个事件循环拥有独立的监听 socket，由内核在它们之间分配新连接，
+        // 新连接直接在接受它的线程上处理，不需要跨线程转交
+        for (auto& loop : loops) {
+            int fd = next_listen_socket(true);
+            listen_fds.push_back(fd);
+            loop->add_listener(fd, nullptr);
         }
-        
-        // 使用 detached 线程处理客户端连接
-        // 注意：在服务器关闭时，这些线程会被强制终止
-        std::thread([this, client_fd]() {
-            handle_client(client_fd);
-        }).detach();
+    } else {
+        // 第一个循环负责 accept，新连接轮询分配给各个循环
+        int fd = next_listen_socket(false);
+        listen_fds.push_back(fd);
+        loops[0]->add_listener(fd, [this](int client_fd) {
+            dispatch_connection(client_fd);
+        });
     }
     
-    LOG_INFO("服务器正在关闭...");
+    // 旧进程的事件循环更多时会剩余监听 socket，其中排队的连接会被重置
+    if (!inherited.empty()) {
+        LOG_WARNING("关闭多余的 " + std::to_string(inherited.size()) + " 个继承的监听socket");
+        for (int fd : inherited) {
+            close(fd);
+        }
+    }
 }
 
+void Server::setup_event_loops() {
+    int num_loops = config.io_threads;
+    if (num_loops <= 0) {
+        num_loops = std::max(1u, std::min(4u, std::thread::hardware_concurrency()));
+    }
+    
+    worker_pool = std::make_unique<ThreadPool>(std::max(1, config.worker_threads),
+                                               std::max(1, config.queue_depth));
+    
+    auto on_request = [this](const ConnectionPtr& conn, std::string_view request) {
+        submit_request(conn, request);
+    };
+    auto on_close = [this](const ConnectionPtr& conn) {
+        // 登录会话不随连接关闭，由 UserManager 按有效期过期
+        // 推送会话和挂起的长轮询请求
+        if (conn->websocket || conn->event_stream || conn->busy) {
+            push_hub->remove_session(conn);
+        }
+    };
+    
+    for (int i = 0; i < num_loops; ++i) {
+        loops.push_back(EventLoop::create(config.io_backend, on_request, on_close,
+                                          static_cast<size_t>(std::max(0, config.max_body_size))));
+        loops.back()->set_push_queue_limits(config.push_queue);
+    }
+}
+
+void Server::dispatch_connection(int client_fd) {
+    size_t index = next_loop.fetch_add(1) % loops.size();
+    loops[index]->add_connection(client_fd);
+}
 
+void Server::submit_request(const ConnectionPtr& conn, std::string_view request) {
+    bool accepted = worker_pool->try_submit([this, conn, request]() {
+        HttpResponse response = handle_request(request, conn->fd);
+        // 请求内存区中只有拼接 JSON 的临时字符串，响应体已复制到堆上的 response 中，整体回收
+        request_arena().reset();
+        conn->loop->send_response(conn, std::move(response));
+    });
+    
+    if (!accepted) {
+        // 队列已满：立即拒绝，让客户端稍后重试，避免排队拖垮尾延迟
+        HttpResponse busy_response(503, "{\"status\":\"error\",\"data\":\"服务器繁忙，请稍后重试\"}");
+        busy_response.add_header("Retry-After", "1");
+        LOG_DEBUG("请求队列已满，拒绝请求，fd: " + std::to_string(conn->fd));
+        conn->loop->send_response(conn, std::move(busy_response));
+    }
+}
 
-void Server::handle_client(int client_fd) {
-    LOG_DEBUG("新客户端连接，fd: " + std::to_string(client_fd));
-    // 增大缓冲区以支持大文件上传 (64KB)
-    char buffer[65536];
-    
-    while (true) {
-        int bytes_read = recv(client_fd, buffer, sizeof(buffer) - 1, 0);
-        if (bytes_read <= 0) {
+bool Server::start_upgrade() {
+    LOG_INFO("收到升级信号，启动新进程: " + config.program_args[0]);
+    try {
+        pid_t pid = hand_off_listeners(config.program_args, listen_fds, UPGRADE_READY_TIMEOUT_MS);
+        LOG_INFO("新进程已接管监听socket，pid: " + std::to_string(pid));
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR(std::string("平滑升级失败，继续运行: ") + e.what());
+        return false;
+    }
+}
+
+void Server::drain_connections() {
+    LOG_INFO("停止接受新连接，等待处理中的请求完成（最长 " +
+             std::to_string(config.drain_timeout) + " 秒）");
+    for (auto& loop : loops) {
+        loop->drain();
+    }
+    // 挂起的长轮询请求立即回复，客户端随后连到新进程
+    push_hub->release_waiters();
+    
+    auto start = std::chrono::steady_clock::now();
+    auto idle_deadline = start + std::chrono::milliseconds(IDLE_DRAIN_GRACE_MS);
+    auto deadline = start + std::chrono::seconds(config.drain_timeout);
+    bool idle_closed = false;
+    size_t remaining = 0;
+    while (g_running) {
+        remaining = 0;
+        for (auto& loop : loops) {
+            remaining += loop->connection_count();
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (remaining == 0 || now >= deadline) {
             break;
         }
-        
-        buffer[bytes_read] = '\0';
-        std::string request(buffer);
-        
-        std::string response = handle_request(request, client_fd);
-        
-        // 检查 send 返回值，处理部分写入
-        size_t total_sent = 0;
-        size_t to_send = response.length();
-        while (total_sent < to_send) {
-            ssize_t sent = send(client_fd, response.c_str() + total_sent, to_send - total_sent, 0);
-            if (sent <= 0) {
-                break;  // 发送失败或连接关闭
+        if (!idle_closed && now >= idle_deadline) {
+            for (auto& loop : loops) {
+                loop->close_idle_connections();
             }
-            total_sent += sent;
+            idle_closed = true;
         }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    if (remaining > 0) {
+        LOG_WARNING("排空超时，强制关闭剩余的 " + std::to_string(remaining) + " 个连接");
+    } else {
+        LOG_INFO("所有连接已排空");
     }
-    // 客户端断开连接，清理在线状态
-    LOG_DEBUG("客户端断开连接，fd: " + std::to_string(client_fd));
-    user_manager->remove_online_user_by_fd(client_fd);
-    close(client_fd);
 }
 
-std::string Server::handle_request(const std::string& request, int client_fd) {
-    // 解析HTTP请求
-    size_t pos = request.find('\n');
-    if (pos == std::string::npos) {
-        return "HTTP/1.1 400 Bad Request\r\n\r\n";
+void Server::run_loop(size_t index) {
+    if (config.pin_cpus) {
+        int num_cpus = std::max(1, static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN)));
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(index % num_cpus, &cpus);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+            LOG_WARNING("事件循环 " + std::to_string(index) + " 绑定CPU失败");
+        }
     }
+    loops[index]->run();
+}
+
+void Server::run() {
+    LOG_INFO("服务器已启动，监听端口: " + std::to_string(port) +
+             "，I/O 后端: " + loops[0]->backend_name() +
+             "，事件循环线程数: " + std::to_string(loops.size()) +
+             (config.reuse_port ? "（SO_REUSEPORT）" : "") +
+             "，工作线程数: " + std::to_string(worker_pool->thread_count()) +
+             "，队列上限: " + std::to_string(worker_pool->max_queue_size()));
     
-    std::string first_line = request.substr(0, pos);
-    size_t method_end = first_line.find(' ');
-    if (method_end == std::string::npos) {
-        return "HTTP/1.1 400 Bad Request\r\n\r\n";
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < loops.size(); ++i) {
+        threads.emplace_back([this, i]() { run_loop(i); });
     }
-    
-    std::string method = first_line.substr(0, method_end);
-    size_t path_start = first_line.find(' ', method_end) + 1;
-    size_t path_end = first_line.find(' ', path_start);
-    if (path_start == std::string::npos || path_end == std::string::npos) {
-        return "HTTP/1.1 400 Bad Request\r\n\r\n";
+    if (config.upgrade_fd != -1) {
+        notify_handoff_ready(config.upgrade_fd);
+        config.upgrade_fd = -1;
+        LOG_INFO("平滑升级完成，已通知旧进程");
     }
     
-    std::string full_path = first_line.substr(path_start, path_end - path_start);
-    
-    // 分离路径和查询参数
-    std::string path = full_path;
-    std::string query_string;
-    size_t query_start = full_path.find('?');
-    if (query_start != std::string::npos) {
-        path = full_path.substr(0, query_start);
-        query_string = full_path.substr(query_start + 1);
+    // 主线程等待停止或升级信号
+    while (g_running) {
+        if (g_upgrade_requested.exchange(false) && start_upgrade()) {
+            drain_connections();
+            break;
+        }
+        push_hub->expire(std::chrono::steady_clock::now());
+        user_manager->expire_sessions();
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
     
-    // 查找请求体
-    size_t body_start = request.find("\r\n\r\n");
-    std::string body;
-    if (body_start != std::string::npos) {
-        body = request.substr(body_start + 4);
+    LOG_INFO("服务器正在关闭...");
+    for (auto& loop : loops) {
+        loop->stop();
     }
+    for (auto& t : threads) {
+        t.join();
+    }
+    worker_pool->shutdown();
     
-    // 提取token
-    std::string token = extract_token_from_request(request);
+    uint64_t requests = 0;
+    uint64_t syscalls = 0;
+    for (auto& loop : loops) {
+        requests += loop->io_stats().requests;
+        syscalls += loop->io_stats().syscalls;
+    }
+    char per_request[32];
+    snprintf(per_request, sizeof(per_request), "%.2f",
+             requests ? static_cast<double>(syscalls) / requests : 0.0);
+    LOG_INFO(std::string("I/O 统计: backend=") + loops[0]->backend_name() +
+             " requests=" + std::to_string(requests) +
+             " syscalls=" + std::to_string(syscalls) +
+             " syscalls_per_request=" + per_request);
     
-    // 认证辅助函数：验证用户是否已登录且token有效
-    auto verify_authenticated = [&](const std::string& username, const std::string& token) -> bool {
-        if (username.empty() || token.empty()) return false;
-        int token_user_id = user_manager->get_user_id_by_token(token);
-        if (token_user_id == -1) return false;
-        int username_user_id = user_manager->get_user_id_by_username(username);
-        return token_user_id == username_user_id;  // token和username必须匹配
-    };
+    LOG_INFO("内存统计: " + memory_stats_json());
+    LOG_INFO("语句缓存统计: " + statement_cache_json());
     
-    // 从 body 或 query_string 提取 username
-    auto extract_username = [&](const std::string& body, const std::string& query) -> std::string {
-        std::string username = parse_json_value(body, "username");
-        if (username.empty()) {
-            size_t pos = query.find("username=");
-            if (pos != std::string::npos) {
-                pos += 8;
-                size_t end = query.find('&', pos);
-                if (end == std::string::npos) end = query.length();
-                username = query.substr(pos, end - pos);
-            }
+    for (const auto& route : router->routes()) {
+        uint64_t count = route->request_count;
+        if (count == 0) {
+            continue;
         }
-        return username;
-    };
+        LOG_INFO("路由统计: " + route->method + " " + route->pattern +
+                 " count=" + std::to_string(count) +
+                 " avg_us=" + std::to_string(route->total_latency_us / count) +
+                 " max_us=" + std::to_string(route->max_latency_us.load()));
+    }
+}
+
+void Server::setup_routes() {
+    router = std::make_unique<Router>();
     
-    // 根据路径和方法处理请求
     // 不需要认证的接口
-    if (path == "/api/register" && method == "POST") {
-        return user_manager->register_user(body);
-    } else if (path == "/api/login" && method == "POST") {
-        return user_manager->login_user(body, client_fd);
-    } else if (path == "/api/get_posts" && method == "GET") {
-        return forum_service->get_posts(query_string);
-    } else if (path.find("/api/post/") == 0 && method == "GET") {
-        std::string post_id_str = path.substr(10);
-        if (!post_id_str.empty()) {
-            int post_id = safe_stoi(post_id_str);
-            if (post_id == -1) {
-                return create_json_response("error", "无效的帖子ID");
-            }
-            return forum_service->get_post_detail(post_id);
+    router->add("POST", "/api/register", false, [this](const RequestContext& ctx) {
+        return user_manager->register_user(ctx.request.body);
+    });
+    router->add("POST", "/api/login", false, [this](const RequestContext& ctx) {
+        return user_manager->login_user(ctx.request.body, ctx.client_fd);
+    });
+    router->add("GET", "/api/get_posts", false, [this](const RequestContext& ctx) {
+        return forum_service->get_posts(ctx.request.query);
+    });
+    router->add("GET", "/api/post/{id}", false, [this](const RequestContext& ctx) {
+        int post_id = safe_stoi(ctx.params.get("id"));
+        if (post_id == -1) {
+            return create_json_response("error", "无效的帖子ID");
         }
+        return forum_service->get_post_detail(post_id);
+    });
+    router->add("GET", "/api/post/", false, [](const RequestContext&) {
         return create_json_response("error", "缺少帖子ID");
-    } else if (path == "/api/get_groups" && method == "GET") {
-        return message_service->get_groups(query_string);
-    }
-    
-    // 以下接口需要认证
-    std::string username = extract_username(body, query_string);
-    if (!verify_authenticated(username, token)) {
-        return create_json_response("error", "未登录或会话已过期");
-    }
+    });
+    router->add("GET", "/api/get_groups", false, [this](const RequestContext& ctx) {
+        return message_service->get_groups(ctx.request.query);
+    });
     
     // 需要认证的接口
-    if (path == "/api/logout" && method == "POST") {
-        return user_manager->logout_user(body, client_fd);
-    } else if (path == "/api/user/profile" && method == "GET") {
-        return user_manager->get_user_profile(query_string);
-    } else if (path == "/api/send_message" && method == "POST") {
-        return message_service->send_message(body);
-    } else if (path == "/api/get_messages" && method == "GET") {
-        return message_service->get_messages(query_string);
-    } else if (path == "/api/get_contacts" && method == "GET") {
-        return message_service->get_contacts(query_string);
-    } else if (path == "/api/create_post" && method == "POST") {
-        return forum_service->create_post(body);
-    } else if (path == "/api/reply_post" && method == "POST") {
-        return forum_service->reply_post(body);
-    } else if (path == "/api/get_post_replies" && method == "GET") {
-        return forum_service->get_post_replies(query_string);
-    } else if (path == "/api/upload_file" && method == "POST") {
-        return file_manager->upload_file(body);
-    } else if (path == "/api/download_file" && method == "GET") {
-        return file_manager->download_file(query_string);
-    } else if (path == "/api/create_group" && method == "POST") {
-        return message_service->create_group(body);
-    } else if (path == "/api/join_group" && method == "POST") {
-        return message_service->join_group(body);
-    } else if (path == "/api/leave_group" && method == "POST") {
-        return message_service->leave_group(body);
-    } else if (path == "/api/get_group_messages" && method == "GET") {
-        return message_service->get_group_messages(query_string);
-    } else if (path == "/api/heartbeat" && method == "POST") {
+    router->add("POST", "/api/logout", true, [this](const RequestContext& ctx) {
+        return user_manager->logout_user(ctx.request.body, ctx.client_fd);
+    });
+    router->add("GET", "/api/user/profile", true, [this](const RequestContext& ctx) {
+        return user_manager->get_user_profile(ctx.request.query);
+    });
+    router->add("POST", "/api/send_message", true, [this](const RequestContext& ctx) {
+        return message_service->send_message(ctx.request.body);
+    });
+    router->add("GET", "/api/get_messages", true, [this](const RequestContext& ctx) {
+        return message_service->get_messages(ctx.request.query);
+    });
+    router->add("GET", "/api/get_contacts", true, [this](const RequestContext& ctx) {
+        return message_service->get_contacts(ctx.request.query);
+    });
+    router->add("POST", "/api/create_post", true, [this](const RequestContext& ctx) {
+        return forum_service->create_post(ctx.request.body);
+    });
+    router->add("POST", "/api/reply_post", true, [this](const RequestContext& ctx) {
+        return forum_service->reply_post(ctx.request.body);
+    });
+    router->add("GET", "/api/get_post_replies", true, [this](const RequestContext& ctx) {
+        return forum_service->get_post_replies(ctx.request.query);
+    });
+    router->add("POST", "/api/upload_file", true, [this](const RequestContext& ctx) {
+        return file_manager->upload_file(ctx.request.body);
+    });
+    router->add("GET", "/api/download_file", true, [this](const RequestContext& ctx) {
+        return file_manager->download_file(ctx.request.query);
+    });
+    router->add("POST", "/api/create_group", true, [this](const RequestContext& ctx) {
+        return message_service->create_group(ctx.request.body);
+    });
+    router->add("POST", "/api/join_group", true, [this](const RequestContext& ctx) {
+        return message_service->join_group(ctx.request.body);
+    });
+    router->add("POST", "/api/leave_group", true, [this](const RequestContext& ctx) {
+        return message_service->leave_group(ctx.request.body);
+    });
+    router->add("GET", "/api/get_group_messages", true, [this](const RequestContext& ctx) {
+        return message_service->get_group_messages(ctx.request.query);
+    });
+    router->add("GET", "/api/conversations", true, [this](const RequestContext& ctx) {
+        return message_service->get_conversations(ctx.request.query);
+    });
+    router->add("POST", "/api/mark_read", true, [this](const RequestContext& ctx) {
+        return message_service->mark_read(ctx.request.body);
+    });
+    router->add("GET", "/api/sync", true, [this](const RequestContext& ctx) {
+        return message_service->sync(ctx.request.query);
+    });
+    router->add("POST", "/api/heartbeat", true, [](const RequestContext&) {
         return create_json_response("success", "heartbeat_ok");
-    } else if (method != "GET" && method != "POST") {
-        return create_json_response("error", "不支持的HTTP方法: " + method);
-    } else {
-        return create_json_response("error", "无效的API路径: " + path + " " + method);
+    });
+    // 推送通道自行验证 token（浏览器的 WebSocket 和 EventSource 无法设置 Authorization）
+    router->add("GET", "/api/ws", false, [this](const RequestContext& ctx) {
+        return open_websocket(ctx.request);
+    });
+    router->add("GET", "/api/events", false, [this](const RequestContext& ctx) {
+        return get_events(ctx.request);
+    });
+    // 运行统计只对已登录用户开放，其中不包含用户ID等可识别在线用户的信息
+    router->add("GET", "/api/stats", true, [this](const RequestContext&) {
+        return create_json_response("success", memory_stats_json());
+    });
+    router->add("GET", "/api/stats/db", true, [this](const RequestContext&) {
+        return create_json_response("success", statement_cache_json());
+    });
+    router->add("GET", "/api/stats/sessions", true, [this](const RequestContext&) {
+        return create_json_response("success", push_hub->queue_stats_json());
+    });
+}
+
+std::string Server::statement_cache_json() const {
+    StatementCacheStats stats = db->statement_cache_stats();
+    uint64_t lookups = stats.hits + stats.misses;
+    char hit_rate[32];
+    snprintf(hit_rate, sizeof(hit_rate), "%.4f", lookups ? static_cast<double>(stats.hits) / lookups : 0.0);
+    return "{\"statement_cache\":{\"hits\":" + std::to_string(stats.hits) +
+           ",\"misses\":" + std::to_string(stats.misses) +
+           ",\"hit_rate\":" + hit_rate +
+           ",\"statements\":" + std::to_string(stats.statements) + "}}";
+}
+
+std::string Server::memory_stats_json() const {
+    uint64_t acquires = 0;
+    uint64_t hits = 0;
+    uint64_t buffers_in_use = 0;
+    uint64_t bytes_pooled = 0;
+    for (const auto& loop : loops) {
+        const BufferPoolStats& stats = loop->buffer_stats();
+        acquires += stats.acquires;
+        hits += stats.hits;
+        buffers_in_use += stats.buffers_in_use;
+        bytes_pooled += stats.bytes_pooled;
     }
+    const ArenaStats& arena = Arena::stats();
+    uint64_t arena_requests = arena.requests;
+    uint64_t arena_hits = arena.hits;
+    
+    auto rate = [](uint64_t part, uint64_t total) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.4f", total ? static_cast<double>(part) / total : 0.0);
+        return std::string(buf);
+    };
+    
+    return "{\"buffer_pool\":{\"acquires\":" + std::to_string(acquires) +
+           ",\"hits\":" + std::to_string(hits) +
+           ",\"hit_rate\":" + rate(hits, acquires) +
+           ",\"buffers_in_use\":" + std::to_string(buffers_in_use) +
+           ",\"bytes_pooled\":" + std::to_string(bytes_pooled) + "}" +
+           ",\"request_arena\":{\"requests\":" + std::to_string(arena_requests) +
+           ",\"hits\":" + std::to_string(arena_hits) +
+           ",\"hit_rate\":" + rate(arena_hits, arena_requests) +
+           ",\"bytes_reserved\":" + std::to_string(arena.bytes_reserved.load()) +
+           ",\"peak_request_bytes\":" + std::to_string(arena.peak_request_bytes.load()) + "}}";
 }
 
-std::string Server::extract_token_from_request(const std::string& request) {
-    std::string auth_header = "Authorization: Bearer ";
-    size_t pos = request.find(auth_header);
-    if (pos == std::string::npos) {
-        return "";
+HttpResponse Server::handle_request(std::string_view raw_request, int client_fd) {
+    // 解析HTTP请求，各字段都是指向 raw_request 的视图
+    HttpRequest request;
+    if (!parse_http_request(raw_request, request)) {
+        return HttpResponse(400, "");
     }
     
-    pos += auth_header.length();
-    size_t end = request.find("\r\n", pos);
-    if (end == std::string::npos) {
-        return "";
+    RouteParams params;
+    Route* route = router->match(request.method, request.path, params);
+    
+    // 需要认证的接口以及未匹配的请求都先验证登录状态
+    if (!route || route->requires_auth) {
+        if (!verify_authenticated(request)) {
+            return create_json_response("error", "未登录或会话已过期");
+        }
+    }
+    
+    if (!route) {
+        if (request.method != "GET" && request.method != "POST") {
+            return create_json_response("error", "不支持的HTTP方法: " + std::string(request.method));
+        }
+        return create_json_response("error", "无效的API路径: " + std::string(request.path) + " " +
+                                    std::string(request.method));
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    HttpResponse response = route->handler(RequestContext{request, params, client_fd});
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    route->record(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    return response;
+}
+
+bool Server::verify_authenticated(const HttpRequest& request) {
+    // username 来自请求体或查询字符串，token 必须属于该用户
+    std::string username = parse_json_value(request.body, "username");
+    if (username.empty()) {
+        username = get_query_param(request.query, "username");
     }
+    std::string_view token = extract_token_from_request(request);
+    if (username.empty() || token.empty()) return false;
     
-    return request.substr(pos, end - pos);
+    // token和username必须匹配；心跳和其他认证请求都会推迟会话过期
+    return user_manager->authenticate(token, username) != -1;
+}
+
+int Server::authenticate_push_client(const HttpRequest& request) {
+    // 除 Authorization 头外也接受查询参数中的 token
+    std::string_view token = extract_token_from_request(request);
+    if (token.empty()) {
+        token = get_query_param(request.query, "token");
+    }
+    if (token.empty()) return -1;
+    return user_manager->authenticate(token);
 }
 
-std::string Server::parse_query_param(const std::string& query_string, const std::string& key) {
-    if (query_string.empty()) {
-        return "";
+HttpResponse Server::open_websocket(const HttpRequest& request) {
+    if (!is_websocket_handshake(request)) {
+        return create_json_response("error", "无效的WebSocket握手请求");
     }
     
-    std::string search_key = key + "=";
-    size_t pos = query_string.find(search_key);
-    if (pos == std::string::npos) {
-        return "";
+    int user_id = authenticate_push_client(request);
+    if (user_id == -1) {
+        return create_json_response("error", "未登录或会话已过期");
     }
     
-    pos += search_key.length();
-    size_t end = query_string.find('&', pos);
-    if (end == std::string::npos) {
-        end = query_string.length();
+    return create_websocket_handshake_response(request, [this, user_id](const ConnectionPtr& conn) {
+        push_hub->add_session(user_id, conn);
+    });
+}
+
+HttpResponse Server::get_events(const HttpRequest& request) {
+    int user_id = authenticate_push_client(request);
+    if (user_id == -1) {
+        return create_json_response("error", "未登录或会话已过期");
     }
     
-    return query_string.substr(pos, end - pos);
+    bool stream = request.header("Accept").find("text/event-stream") != std::string_view::npos;
+    return message_service->get_events(user_id, request.query, request.header("Last-Event-ID"), stream);
+}
+
+std::string_view Server::extract_token_from_request(const HttpRequest& request) {
+    static const std::string_view bearer = "Bearer ";
+    std::string_view auth_header = request.header("Authorization");
+    if (auth_header.compare(0, bearer.length(), bearer) != 0) {
+        return {};
+    }
+    return auth_header.substr(bearer.length());
 }
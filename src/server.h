@@ -7,32 +7,77 @@
 #include <vector>
 #include <mutex>
 #include "common.h"
+#include "connection.h"
+#include "event_loop.h"
 #include <atomic>
+#include <sys/socket.h>
 
 // 全局运行标志
 extern std::atomic<bool> g_running;
+// 收到 SIGUSR2 后置位，请求平滑升级
+extern std::atomic<bool> g_upgrade_requested;
 #include "user_manager.h"
 #include "message_service.h"
 #include "forum_service.h"
 #include "file_manager.h"
+#include "push_hub.h"
+#include "group_fanout.h"
+#include "database.h"
 
 // 前向声明
-class Database;
+class ThreadPool;
+class Router;
+struct HttpRequest;
+
+// 服务器启动配置
+struct ServerConfig {
+    int port = 8080;
+    int io_threads = 0;  // 事件循环线程数，0 表示按 CPU 核数自动选择
+    int worker_threads = 8;  // 处理请求的工作线程数
+    int queue_depth = 1024;  // 等待处理的请求上限，超出时返回 503
+    int max_body_size = 16 * 1024 * 1024;  // 请求体上限（字节），超出时返回 413
+    int backlog = SOMAXCONN;  // listen() 的连接队列长度
+    bool reuse_port = false;  // 每个事件循环使用独立的 SO_REUSEPORT 监听 socket
+    bool pin_cpus = false;    // 把事件循环线程绑定到各自的 CPU 核心
+    IoBackend io_backend = IoBackend::EPOLL;  // 事件循环使用的 I/O 后端
+    int drain_timeout = 30;   // 平滑升级时等待处理中请求完成的最长秒数
+    int session_ttl = DEFAULT_SESSION_TTL_SECONDS;  // 登录会话在没有任何认证请求后保留的秒数
+    WriteBatchConfig db_write_batch;  // 消息批量提交的行数上限和等待窗口
+    PushQueueLimits push_queue;  // WebSocket / SSE 连接的发送队列上限和溢出策略
+    int upgrade_fd = -1;      // 从旧进程接收监听 socket 的 Unix socket，-1 表示正常启动
+    bool check_query_plans = false;  // 只检查热点查询的执行计划后退出，不启动服务器
+    std::vector<std::string> program_args;  // 启动参数，平滑升级时用于启动新进程
+};
 
 class Server {
 public:
-    Server(int port);
+    Server(const ServerConfig& config);
     ~Server();
     
     void run();
     
 private:
-    int server_fd;
+    std::vector<int> listen_fds;
     int port;
+    ServerConfig config;
+    
+    // 事件循环（每个线程一个）
+    std::vector<std::unique_ptr<EventLoop>> loops;
+    std::atomic<size_t> next_loop;
+    
+    // 路由表
+    std::unique_ptr<Router> router;
+    
+    // 工作线程池（请求处理）
+    std::unique_ptr<ThreadPool> worker_pool;
     
     // 数据库
     std::unique_ptr<Database> db;
     
+    // WebSocket 推送会话
+    std::unique_ptr<PushHub> push_hub;
+    std::unique_ptr<GroupFanout> group_fanout;
+    
     // 功能模块
     std::unique_ptr<UserManager> user_manager;
     std::unique_ptr<MessageService> message_service;
@@ -41,10 +86,28 @@ private:
     
     // 核心服务器功能
     void setup_server();
-    void handle_client(int client_fd);
-    std::string handle_request(const std::string& request, int client_fd);
-    std::string extract_token_from_request(const std::string& request);
-    std::string parse_query_param(const std::string& query_string, const std::string& key);
+    void setup_event_loops();
+    void setup_routes();
+    int create_listen_socket(bool reuse_port);
+    void run_loop(size_t index);
+    void dispatch_connection(int client_fd);
+    // 平滑升级：把监听 socket 交给新进程，成功后排空本进程的连接
+    bool start_upgrade();
+    void drain_connections();
+    void submit_request(const ConnectionPtr& conn, std::string_view request);
+    HttpResponse handle_request(std::string_view request, int client_fd);
+    bool verify_authenticated(const HttpRequest& request);
+    std::string_view extract_token_from_request(const HttpRequest& request);
+    // 推送通道的认证：token 来自 Authorization 头或 token 查询参数，返回用户ID，无效时返回 -1
+    int authenticate_push_client(const HttpRequest& request);
+    // WebSocket 握手：验证 token 后升级连接并登记推送会话
+    HttpResponse open_websocket(const HttpRequest& request);
+    // 长轮询 / SSE 事件接口
+    HttpResponse get_events(const HttpRequest& request);
+    // 缓冲区池和请求内存区的统计（JSON）
+    std::string memory_stats_json() const;
+    // 数据库预编译语句缓存的统计（JSON）
+    std::string statement_cache_json() const;
 };
 
 #endif // SERVER_H
@@ -0,0 +1,296 @@
+#include "session_table.h"
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <openssl/rand.h>
+
+static const char TOKEN_CHARS[] =
+    "0123456789"
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+    "abcdefghijklmnopqrstuvwxyz";
+static const size_t TOKEN_CHAR_COUNT = sizeof(TOKEN_CHARS) - 1;
+
+// token 字符在字符集中的位置，不在字符集中的为 -1
+static int token_char_index(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'Z') return 10 + (c - 'A');
+    if (c >= 'a' && c <= 'z') return 36 + (c - 'a');
+    return -1;
+}
+
+SessionTable::SessionTable(size_t shard_count, uint32_t tick_ms, uint64_t now_ms) : ttl_ms(0) {
+    size_t count = 1;
+    while (count < shard_count && count < MAX_SHARDS) {
+        count <<= 1;
+    }
+    mask = count - 1;
+    for (size_t i = 0; i < count; ++i) {
+        shards.push_back(std::make_unique<Shard>(tick_ms, now_ms));
+        fd_shards.push_back(std::make_unique<FdShard>());
+    }
+}
+
+std::string SessionTable::login(User& user, bool& was_online, const std::function<void()>& on_login) {
+    std::string token = generate_token(user.user_id);
+    if (token.empty()) {
+        return token;
+    }
+    Shard& shard = user_shard(user.user_id);
+    int previous_fd = -1;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.sessions.find(user.user_id);
+        was_online = it != shard.sessions.end();
+        if (was_online) {
+            user.session_timer = it->second.user.session_timer;
+            previous_fd = it->second.user.socket_fd;
+        } else {
+            it = shard.sessions.emplace(user.user_id, Session()).first;
+        }
+        user.token = token;
+        user.session_timer = shard.timers.reschedule(user.session_timer, ttl_ms.load(std::memory_order_relaxed),
+                                                     static_cast<uint64_t>(user.user_id));
+        it->second.user = user;
+        TokenKey key = make_key(token);
+        std::vector<TokenKey>& tokens = it->second.tokens;
+        if (tokens.size() >= MAX_TOKENS_PER_USER) {
+            shard.tokens.erase(tokens.front());
+            tokens.erase(tokens.begin());
+        }
+        tokens.push_back(key);
+        shard.tokens[key] = user.user_id;
+
+        if (previous_fd != user.socket_fd) {
+            unbind_fd(previous_fd, user.user_id);
+            bind_fd(user.socket_fd, user.user_id);
+        }
+        if (on_login) {
+            on_login();
+        }
+    }
+    return token;
+}
+
+bool SessionTable::logout(int user_id, User& user) {
+    Shard& shard = user_shard(user_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.sessions.find(user_id);
+    if (it == shard.sessions.end()) {
+        return false;
+    }
+    shard.timers.cancel(it->second.user.session_timer);
+    user = it->second.user;
+    remove_locked(shard, it);
+    return true;
+}
+
+int SessionTable::authenticate(std::string_view token, std::string_view username) {
+    return authenticate_token(token, &username);
+}
+
+int SessionTable::authenticate(std::string_view token) {
+    return authenticate_token(token, nullptr);
+}
+
+int SessionTable::find_token(std::string_view token) const {
+    if (token.size() != TOKEN_LENGTH) {
+        return -1;
+    }
+    TokenKey key = make_key(token);
+    Shard& shard = token_shard(token);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.tokens.find(key);
+    return it == shard.tokens.end() ? -1 : it->second;
+}
+
+int SessionTable::find_fd(int client_fd) const {
+    FdShard& shard = fd_shard(client_fd);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.users.find(client_fd);
+    return it == shard.users.end() ? -1 : it->second;
+}
+
+bool SessionTable::find(int user_id, User& user) const {
+    Shard& shard = user_shard(user_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.sessions.find(user_id);
+    if (it == shard.sessions.end()) {
+        return false;
+    }
+    user = it->second.user;
+    return true;
+}
+
+bool SessionTable::online(int user_id) const {
+    Shard& shard = user_shard(user_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.sessions.find(user_id) != shard.sessions.end();
+}
+
+bool SessionTable::run_if_offline(int user_id, const std::function<void()>& fn) {
+    Shard& shard = user_shard(user_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.sessions.find(user_id) != shard.sessions.end()) {
+        return false;
+    }
+    fn();
+    return true;
+}
+
+void SessionTable::set_ttl(uint64_t ttl) {
+    ttl_ms.store(ttl, std::memory_order_relaxed);
+}
+
+void SessionTable::expire(uint64_t now_ms, const std::function<bool(int user_id)>& keep_alive,
+                          std::vector<User>& expired) {
+    std::vector<uint64_t> keys;
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        keys.clear();
+        shard->timers.advance(now_ms, keys);
+        for (uint64_t key : keys) {
+            auto it = shard->sessions.find(static_cast<int>(key));
+            if (it == shard->sessions.end()) {
+                continue;
+            }
+            User& user = it->second.user;
+            if (keep_alive(user.user_id)) {
+                user.last_seen = std::time(nullptr);
+                user.session_timer = shard->timers.reschedule(user.session_timer,
+                                                              ttl_ms.load(std::memory_order_relaxed), key);
+                continue;
+            }
+            expired.push_back(it->second.user);
+            remove_locked(*shard, it);
+        }
+    }
+}
+
+size_t SessionTable::size() const {
+    size_t total = 0;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total += shard->sessions.size();
+    }
+    return total;
+}
+
+SessionTable::Shard& SessionTable::user_shard(int user_id) const {
+    return *shards[static_cast<uint32_t>(user_id) & mask];
+}
+
+SessionTable::Shard& SessionTable::token_shard(std::string_view token) const {
+    int index = token.empty() ? -1 : token_char_index(token[0]);
+    return *shards[index < 0 ? 0 : static_cast<size_t>(index) & mask];
+}
+
+SessionTable::TokenKey SessionTable::make_key(std::string_view token) {
+    TokenKey key;
+    std::memcpy(key.bytes, token.data(), TOKEN_LENGTH);
+    return key;
+}
+
+bool SessionTable::TokenKey::operator==(const TokenKey& other) const {
+    return std::memcmp(bytes, other.bytes, TOKEN_LENGTH) == 0;
+}
+
+// 首字符编码了分片，其后的字符都是随机的，取 8 个字节即可
+size_t SessionTable::TokenHash::operator()(const TokenKey& key) const {
+    uint64_t hash;
+    std::memcpy(&hash, key.bytes + 1, sizeof(hash));
+    return static_cast<size_t>(hash);
+}
+
+SessionTable::FdShard& SessionTable::fd_shard(int client_fd) const {
+    return *fd_shards[static_cast<uint32_t>(client_fd) & mask];
+}
+
+// 首字符在字符集中的位置对分片数取模等于用户所在的分片，其余字符随机。
+// 随机字节来自 RAND_bytes，超出字符集整数倍的字节丢弃，避免取模带来的偏差
+std::string SessionTable::generate_token(int user_id) const {
+    size_t shard = static_cast<uint32_t>(user_id) & mask;
+    size_t stride = mask + 1;
+    size_t first_count = (TOKEN_CHAR_COUNT - 1 - shard) / stride + 1;
+
+    std::string token;
+    token.reserve(TOKEN_LENGTH);
+    unsigned char bytes[TOKEN_LENGTH * 2];
+    while (token.size() < TOKEN_LENGTH) {
+        if (RAND_bytes(bytes, sizeof(bytes)) != 1) {
+            std::cerr << "生成 token 失败" << std::endl;
+            return "";
+        }
+        for (unsigned char byte : bytes) {
+            if (token.size() == TOKEN_LENGTH) {
+                break;
+            }
+            size_t count = token.empty() ? first_count : TOKEN_CHAR_COUNT;
+            if (byte >= 256 - 256 % count) {
+                continue;
+            }
+            size_t index = byte % count;
+            token += TOKEN_CHARS[token.empty() ? shard + index * stride : index];
+        }
+    }
+    return token;
+}
+
+int SessionTable::authenticate_token(std::string_view token, const std::string_view* username) {
+    if (token.size() != TOKEN_LENGTH) {
+        return -1;
+    }
+    TokenKey key = make_key(token);
+    Shard& shard = token_shard(token);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto token_it = shard.tokens.find(key);
+    if (token_it == shard.tokens.end()) {
+        return -1;
+    }
+    auto it = shard.sessions.find(token_it->second);
+    if (it == shard.sessions.end() || (username && it->second.user.username != *username)) {
+        return -1;
+    }
+    touch_locked(shard, it->second.user);
+    return it->first;
+}
+
+// 定时器精度为秒级，同一秒内已经推迟过的会话不再重新挂到时间轮上
+void SessionTable::touch_locked(Shard& shard, User& user) {
+    long long now = std::time(nullptr);
+    if (now == user.last_seen) {
+        return;
+    }
+    user.last_seen = now;
+    user.session_timer = shard.timers.reschedule(user.session_timer, ttl_ms.load(std::memory_order_relaxed),
+                                                 static_cast<uint64_t>(user.user_id));
+}
+
+void SessionTable::remove_locked(Shard& shard, std::unordered_map<int, Session>::iterator it) {
+    for (const TokenKey& token : it->second.tokens) {
+        shard.tokens.erase(token);
+    }
+    unbind_fd(it->second.user.socket_fd, it->first);
+    shard.sessions.erase(it);
+}
+
+void SessionTable::bind_fd(int client_fd, int user_id) {
+    if (client_fd < 0) {
+        return;
+    }
+    FdShard& shard = fd_shard(client_fd);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.users[client_fd] = user_id;
+}
+
+// fd 可能已被其他用户的新连接复用，只移除仍指向该用户的映射
+void SessionTable::unbind_fd(int client_fd, int user_id) {
+    if (client_fd < 0) {
+        return;
+    }
+    FdShard& shard = fd_shard(client_fd);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.users.find(client_fd);
+    if (it != shard.users.end() && it->second == user_id) {
+        shard.users.erase(it);
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef SESSION_TABLE_H
+#define SESSION_TABLE_H
+
+#include "common.h"
+#include "timer_wheel.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// 登录会话表：按用户ID分片，每个分片一把锁，分片内保存会话、token 索引和会话过期定时器
+// token 的首字符编码了所属分片，按 token 认证只锁一个分片、查一次 token 表和一次会话表，
+// 耗时与在线用户数无关。连接 fd 到用户ID的索引按 fd 另行分片；
+// 需要同时持有两把锁时总是先锁会话分片再锁 fd 分片
+class SessionTable {
+public:
+    static const size_t MAX_SHARDS = 32;  // 不超过 token 字符集大小
+    static const size_t TOKEN_LENGTH = 32;
+    // 每个用户同时有效的 token 数上限（多个设备各自登录），超出时最早的 token 失效
+    static const size_t MAX_TOKENS_PER_USER = 8;
+
+    // shard_count 向上取整为 2 的幂，范围 1 到 MAX_SHARDS
+    SessionTable(size_t shard_count, uint32_t tick_ms, uint64_t now_ms);
+
+    // 登录：生成新 token 并返回，user 的 token、session_timer 随之更新。
+    // 重复登录沿用原来的会话定时器，之前的 token 仍然有效，最多保留 MAX_TOKENS_PER_USER 个；
+    // 生成随机数失败时返回空字符串，会话表不变。on_login 在会话写入后、释放分片锁之前调用
+    std::string login(User& user, bool& was_online, const std::function<void()>& on_login = nullptr);
+    // 结束会话并移除该用户的所有 token，会话不存在时返回 false
+    bool logout(int user_id, User& user);
+
+    // token 有效且属于 username 时返回用户ID并推迟会话过期，否则返回 -1
+    int authenticate(std::string_view token, std::string_view username);
+    // 只校验 token（推送连接），有效时推迟会话过期
+    int authenticate(std::string_view token);
+
+    int find_token(std::string_view token) const;  // 不推迟过期
+    int find_fd(int client_fd) const;
+    bool find(int user_id, User& user) const;
+    bool online(int user_id) const;
+    // 持有用户所在分片的锁确认该用户没有会话后调用 fn，返回是否调用；
+    // 与 login 的 on_login 互斥，用于维护随会话存在的外部状态
+    bool run_if_offline(int user_id, const std::function<void()>& fn);
+
+    void set_ttl(uint64_t ttl_ms);
+    // 推进各分片的定时器到 now_ms，移除过期会话并追加到 expired；
+    // keep_alive 返回 true 的用户视为仍然活跃，重新开始计时
+    void expire(uint64_t now_ms, const std::function<bool(int user_id)>& keep_alive,
+                std::vector<User>& expired);
+    size_t size() const;
+
+private:
+    // token 定长，直接存放在哈希表节点中，查找时不需要分配内存
+    struct TokenKey {
+        char bytes[TOKEN_LENGTH];
+        bool operator==(const TokenKey& other) const;
+    };
+    struct TokenHash {
+        size_t operator()(const TokenKey& key) const;
+    };
+
+    struct Session {
+        User user;
+        std::vector<TokenKey> tokens;  // 该用户的所有有效 token，按登录先后排列
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<int, Session> sessions;
+        std::unordered_map<TokenKey, int, TokenHash> tokens;  // token 到用户ID
+        TimerWheel timers;
+
+        Shard(uint32_t tick_ms, uint64_t now_ms) : timers(tick_ms, now_ms) {}
+    };
+
+    struct FdShard {
+        mutable std::mutex mutex;
+        std::unordered_map<int, int> users;  // fd 到用户ID
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::vector<std::unique_ptr<FdShard>> fd_shards;
+    size_t mask;
+    std::atomic<uint64_t> ttl_ms;
+
+    Shard& user_shard(int user_id) const;
+    Shard& token_shard(std::string_view token) const;
+    static TokenKey make_key(std::string_view token);  // 调用方保证长度为 TOKEN_LENGTH
+    FdShard& fd_shard(int client_fd) const;
+    std::string generate_token(int user_id) const;
+
+    // username 为空指针时只校验 token
+    int authenticate_token(std::string_view token, const std::string_view* username);
+    // 以下调用方持有会话分片的锁
+    void touch_locked(Shard& shard, User& user);
+    void remove_locked(Shard& shard, std::unordered_map<int, Session>::iterator it);
+    void bind_fd(int client_fd, int user_id);
+    void unbind_fd(int client_fd, int user_id);
+};
+
+#endif // SESSION_TABLE_H
@@ -0,0 +1,161 @@
+#include "socket_handoff.h"
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+const size_t MAX_HANDOFF_FDS = 64;
+const char LISTENERS_MSG = 'L';
+const char READY_MSG = 'R';
+
+void send_fds(int channel_fd, const std::vector<int>& fds) {
+    if (fds.empty() || fds.size() > MAX_HANDOFF_FDS) {
+        throw std::runtime_error("监听socket数量无效: " + std::to_string(fds.size()));
+    }
+
+    char data = LISTENERS_MSG;
+    iovec iov{&data, sizeof(data)};
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * fds.size()));
+
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+    memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+
+    ssize_t n;
+    do {
+        n = sendmsg(channel_fd, &msg, MSG_NOSIGNAL);
+    } while (n == -1 && errno == EINTR);
+    if (n != sizeof(data)) {
+        throw std::runtime_error("发送监听socket失败: " + std::string(strerror(errno)));
+    }
+}
+
+void wait_ready(int channel_fd, int timeout_ms) {
+    pollfd pfd{channel_fd, POLLIN, 0};
+    int ret;
+    do {
+        ret = poll(&pfd, 1, timeout_ms);
+    } while (ret == -1 && errno == EINTR);
+    if (ret == 0) {
+        throw std::runtime_error("等待新进程就绪超时");
+    }
+
+    char data = 0;
+    ssize_t n;
+    do {
+        n = read(channel_fd, &data, sizeof(data));
+    } while (n == -1 && errno == EINTR);
+    if (n != sizeof(data) || data != READY_MSG) {
+        throw std::runtime_error("新进程启动失败");
+    }
+}
+
+}  // namespace
+
+pid_t hand_off_listeners(const std::vector<std::string>& args, const std::vector<int>& listen_fds,
+                         int ready_timeout_ms) {
+    if (args.empty()) {
+        throw std::runtime_error("缺少新进程的启动参数");
+    }
+
+    int channel[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, channel) == -1) {
+        throw std::runtime_error("创建升级通道失败");
+    }
+
+    // fork 之后的子进程只能调用 async-signal-safe 函数，参数提前准备好
+    std::vector<std::string> child_args = args;
+    child_args.push_back("--upgrade-fd=" + std::to_string(channel[1]));
+    std::vector<char*> argv;
+    for (auto& arg : child_args) {
+        argv.push_back(&arg[0]);
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        close(channel[0]);
+        close(channel[1]);
+        throw std::runtime_error("fork 失败");
+    }
+    if (pid == 0) {
+        fcntl(channel[1], F_SETFD, 0);
+        execvp(argv[0], argv.data());
+        _exit(127);
+    }
+
+    close(channel[1]);
+    try {
+        send_fds(channel[0], listen_fds);
+        wait_ready(channel[0], ready_timeout_ms);
+    } catch (...) {
+        close(channel[0]);
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+        throw;
+    }
+    close(channel[0]);
+    return pid;
+}
+
+std::vector<int> receive_listeners(int channel_fd) {
+    char data = 0;
+    iovec iov{&data, sizeof(data)};
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * MAX_HANDOFF_FDS));
+
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+
+    ssize_t n;
+    do {
+        n = recvmsg(channel_fd, &msg, MSG_CMSG_CLOEXEC);
+    } while (n == -1 && errno == EINTR);
+    if (n != sizeof(data) || data != LISTENERS_MSG || (msg.msg_flags & MSG_CTRUNC)) {
+        throw std::runtime_error("从旧进程接收监听socket失败");
+    }
+
+    std::vector<int> fds;
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+        size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        const unsigned char* p = CMSG_DATA(cmsg);
+        for (size_t i = 0; i < count; ++i) {
+            int fd;
+            memcpy(&fd, p + i * sizeof(int), sizeof(int));
+            fds.push_back(fd);
+        }
+    }
+    if (fds.empty()) {
+        throw std::runtime_error("旧进程没有发送监听socket");
+    }
+    return fds;
+}
+
+void notify_handoff_ready(int channel_fd) {
+    char data = READY_MSG;
+    ssize_t n;
+    do {
+        n = send(channel_fd, &data, sizeof(data), MSG_NOSIGNAL);
+    } while (n == -1 && errno == EINTR);
+    close(channel_fd);
+}
@@ -0,0 +1,23 @@
+#ifndef SOCKET_HANDOFF_H
+#define SOCKET_HANDOFF_H
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+// 平滑升级：旧进程启动新版本进程，通过 Unix socket（SCM_RIGHTS）把监听 socket 交给它，
+// 新进程初始化完成后通知旧进程，旧进程再停止接受连接并排空处理中的请求
+// 整个过程中监听 socket 一直打开，客户端不会遇到连接被拒绝
+
+// 旧进程：以 args 启动新进程（追加 --upgrade-fd=N），发送 listen_fds 并等待其就绪
+// 返回新进程 pid；失败时终止新进程并抛出 std::runtime_error
+pid_t hand_off_listeners(const std::vector<std::string>& args, const std::vector<int>& listen_fds,
+                         int ready_timeout_ms);
+
+// 新进程：从 channel_fd 接收旧进程的监听 socket，失败时抛出 std::runtime_error
+std::vector<int> receive_listeners(int channel_fd);
+
+// 新进程：开始接受连接后通知旧进程，并关闭 channel_fd
+void notify_handoff_ready(int channel_fd);
+
+#endif // SOCKET_HANDOFF_H
@@ -0,0 +1,86 @@
+#include "thread_pool.h"
+#include "logger.h"
+
+ThreadPool::ThreadPool(size_t num_threads, size_t max_queue_size)
+    : capacity(max_queue_size), stopping(false), rejected(0) {
+    if (num_threads == 0) {
+        num_threads = 1;
+    }
+    workers.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; ++i) {
+        workers.emplace_back([this]() { worker_loop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    shutdown();
+}
+
+bool ThreadPool::try_submit(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (stopping || tasks.size() >= capacity) {
+            ++rejected;
+            return false;
+        }
+        tasks.push_back(std::move(task));
+    }
+    queue_cv.notify_one();
+    return true;
+}
+
+void ThreadPool::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (stopping && workers.empty()) {
+            return;
+        }
+        stopping = true;
+    }
+    queue_cv.notify_all();
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers.clear();
+}
+
+size_t ThreadPool::thread_count() const {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    return workers.size();
+}
+
+size_t ThreadPool::queue_size() const {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    return tasks.size();
+}
+
+size_t ThreadPool::max_queue_size() const {
+    return capacity;
+}
+
+uint64_t ThreadPool::rejected_count() const {
+    return rejected;
+}
+
+void ThreadPool::worker_loop() {
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_cv.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (tasks.empty()) {
+                return;  // stopping 且队列已清空
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+
+        try {
+            task();
+        } catch (const std::exception& e) {
+            LOG_ERROR("工作线程任务异常: " + std::string(e.what()));
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+// 固定大小的工作线程池，任务队列有上限
+// 队列满时 try_submit 立即返回 false，由调用方决定如何拒绝请求
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    ThreadPool(size_t num_threads, size_t max_queue_size);
+    ~ThreadPool();
+
+    // 提交任务（线程安全），队列已满或已关闭时返回 false
+    bool try_submit(Task task);
+    // 停止接收新任务，执行完队列中剩余的任务后回收所有线程
+    void shutdown();
+
+    size_t thread_count() const;
+    size_t queue_size() const;
+    size_t max_queue_size() const;
+    uint64_t rejected_count() const;
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<Task> tasks;
+    size_t capacity;
+    bool stopping;
+    mutable std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::atomic<uint64_t> rejected;
+
+    void worker_loop();
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,166 @@
+#include "timer_wheel.h"
+
+TimerWheel::TimerWheel(uint32_t tick_ms, uint64_t now_ms)
+    : tick_ms(tick_ms == 0 ? 1 : tick_ms), start_ms(now_ms), current_tick(0), active(0) {
+    for (uint32_t& head : slots) {
+        head = NIL;
+    }
+}
+
+TimerWheel::TimerId TimerWheel::schedule(uint64_t delay_ms, uint64_t key) {
+    uint32_t index;
+    if (!free_nodes.empty()) {
+        index = free_nodes.back();
+        free_nodes.pop_back();
+    } else {
+        index = static_cast<uint32_t>(nodes.size());
+        nodes.push_back(Node{0, 0, NIL, NIL, 1, NIL});
+    }
+
+    Node& node = nodes[index];
+    node.expires = expires_after(delay_ms);
+    node.key = key;
+    link(index);
+    ++active;
+    return (static_cast<uint64_t>(node.generation) << 32) | index;
+}
+
+bool TimerWheel::cancel(TimerId id) {
+    Node* node = find(id);
+    if (!node) {
+        return false;
+    }
+    uint32_t index = static_cast<uint32_t>(id);
+    unlink(index);
+    release(index);
+    return true;
+}
+
+TimerWheel::TimerId TimerWheel::reschedule(TimerId id, uint64_t delay_ms, uint64_t key) {
+    Node* node = find(id);
+    if (!node) {
+        return schedule(delay_ms, key);
+    }
+    // 原地移动到新的槽，不重新分配节点
+    uint32_t index = static_cast<uint32_t>(id);
+    unlink(index);
+    node->expires = expires_after(delay_ms);
+    node->key = key;
+    link(index);
+    return id;
+}
+
+void TimerWheel::advance(uint64_t now_ms, std::vector<uint64_t>& expired) {
+    if (now_ms < start_ms) {
+        return;
+    }
+    uint64_t target_tick = (now_ms - start_ms) / tick_ms;
+    while (current_tick <= target_tick) {
+        uint32_t index = current_tick & SLOT_MASK;
+        // 最低层转完一圈，从上层取出即将到期的槽
+        if (index == 0) {
+            for (int level = 1; level < LEVELS; ++level) {
+                uint32_t slot = (current_tick >> (level * LEVEL_BITS)) & SLOT_MASK;
+                cascade(level, slot);
+                if (slot != 0) {
+                    break;
+                }
+            }
+        }
+
+        // 先摘下整条链表再处理，这一 tick 之内新建的定时器放到下一个 tick
+        uint32_t head = slots[index];
+        slots[index] = NIL;
+        ++current_tick;
+        while (head != NIL) {
+            uint32_t next = nodes[head].next;
+            expired.push_back(nodes[head].key);
+            release(head);
+            head = next;
+        }
+    }
+}
+
+size_t TimerWheel::size() const {
+    return active;
+}
+
+TimerWheel::Node* TimerWheel::find(TimerId id) {
+    uint32_t index = static_cast<uint32_t>(id);
+    uint32_t generation = static_cast<uint32_t>(id >> 32);
+    if (index >= nodes.size()) {
+        return nullptr;
+    }
+    Node& node = nodes[index];
+    if (node.slot == NIL || node.generation != generation) {
+        return nullptr;
+    }
+    return &node;
+}
+
+uint64_t TimerWheel::expires_after(uint64_t delay_ms) const {
+    // 向上取整，保证不会早于 delay_ms 到期
+    return current_tick + (delay_ms + tick_ms - 1) / tick_ms;
+}
+
+void TimerWheel::link(uint32_t index) {
+    Node& node = nodes[index];
+    if (node.expires < current_tick) {
+        node.expires = current_tick;
+    }
+    uint64_t delta = node.expires - current_tick;
+
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= (1ull << ((level + 1) * LEVEL_BITS))) {
+        ++level;
+    }
+    // 超出时间轮范围的定时器放在最高层最远的槽，逐级下移时重新计算
+    uint64_t max_delta = (1ull << (LEVELS * LEVEL_BITS)) - 1;
+    if (delta > max_delta) {
+        node.expires = current_tick + max_delta;
+    }
+
+    uint32_t slot = level * SLOTS + ((node.expires >> (level * LEVEL_BITS)) & SLOT_MASK);
+    node.slot = slot;
+    node.prev = NIL;
+    node.next = slots[slot];
+    if (node.next != NIL) {
+        nodes[node.next].prev = index;
+    }
+    slots[slot] = index;
+}
+
+void TimerWheel::unlink(uint32_t index) {
+    Node& node = nodes[index];
+    if (node.prev != NIL) {
+        nodes[node.prev].next = node.next;
+    } else {
+        slots[node.slot] = node.next;
+    }
+    if (node.next != NIL) {
+        nodes[node.next].prev = node.prev;
+    }
+    node.prev = NIL;
+    node.next = NIL;
+}
+
+void TimerWheel::release(uint32_t index) {
+    Node& node = nodes[index];
+    node.slot = NIL;
+    ++node.generation;
+    if (node.generation == 0) {
+        node.generation = 1;  // ID 不能为 INVALID_TIMER
+    }
+    free_nodes.push_back(index);
+    --active;
+}
+
+void TimerWheel::cascade(int level, uint32_t slot) {
+    uint32_t head = slots[level * SLOTS + slot];
+    slots[level * SLOTS + slot] = NIL;
+    while (head != NIL) {
+        uint32_t next = nodes[head].next;
+        link(head);
+        head = next;
+    }
+}
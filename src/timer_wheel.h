@@ -0,0 +1,66 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// 分层时间轮：4 层，每层 256 个槽，最小精度为一个 tick
+// 定时器节点保存在数组中，用下标组成每个槽的双向链表，插入、取消、重新设置都是 O(1)；
+// 推进时间时只处理当前槽，上层槽中的定时器在下层转完一圈时逐级移到下层
+// 不是线程安全的，由使用方加锁
+class TimerWheel {
+public:
+    // 高 32 位为节点的代数，低 32 位为节点下标；节点复用后旧的 ID 自动失效
+    using TimerId = uint64_t;
+    static const TimerId INVALID_TIMER = 0;
+
+    TimerWheel(uint32_t tick_ms, uint64_t now_ms);
+
+    // 新建在 delay_ms 之后到期的定时器，到期时 advance() 返回 key
+    TimerId schedule(uint64_t delay_ms, uint64_t key);
+    // 取消定时器，已到期或已取消时返回 false
+    bool cancel(TimerId id);
+    // 把定时器改为 delay_ms 之后到期并返回其 ID，id 已失效时新建一个
+    TimerId reschedule(TimerId id, uint64_t delay_ms, uint64_t key);
+
+    // 推进到 now_ms，把到期定时器的 key 追加到 expired
+    void advance(uint64_t now_ms, std::vector<uint64_t>& expired);
+
+    size_t size() const;
+
+private:
+    static const int LEVEL_BITS = 8;
+    static const uint32_t SLOTS = 1u << LEVEL_BITS;
+    static const uint32_t SLOT_MASK = SLOTS - 1;
+    static const int LEVELS = 4;
+    static const uint32_t NIL = UINT32_MAX;
+
+    struct Node {
+        uint64_t expires;     // 到期的 tick
+        uint64_t key;
+        uint32_t prev;
+        uint32_t next;
+        uint32_t generation;
+        uint32_t slot;        // 所在的槽，NIL 表示节点空闲
+    };
+
+    uint32_t tick_ms;
+    uint64_t start_ms;
+    uint64_t current_tick;  // 下一个要处理的 tick
+    std::vector<Node> nodes;
+    std::vector<uint32_t> free_nodes;
+    uint32_t slots[LEVELS * SLOTS];  // 每个槽链表的头节点
+    size_t active;
+
+    Node* find(TimerId id);
+    uint64_t expires_after(uint64_t delay_ms) const;
+    // 按 expires 放入对应层的槽
+    void link(uint32_t index);
+    void unlink(uint32_t index);
+    void release(uint32_t index);
+    // 把上层一个槽中的定时器重新分配到下层
+    void cascade(int level, uint32_t slot);
+};
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,612 @@
+#include "uring_loop.h"
+#include "logger.h"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+extern std::atomic<bool> g_running;
+
+namespace {
+const unsigned RING_ENTRIES = 1024;
+const unsigned CQ_ENTRIES = RING_ENTRIES * 4;  // 多次触发的请求会产生大量完成事件
+const long WAIT_TIMEOUT_NS = 500 * 1000 * 1000;  // 定期醒来检查 g_running
+const unsigned BUF_COUNT = 256;     // 共享读缓冲区个数
+const size_t BUF_SIZE = 16384;
+const uint16_t BUF_GROUP = 0;
+const size_t MAX_IOV = 64;  // 一次 sendmsg 使用的 iovec 上限
+const unsigned PROBE_OPS = 256;  // 探测支持的操作码时查询的个数
+const int SETUP_WAIT_ATTEMPTS = 4;  // 初始化时同步等待完成事件的次数，每次最长 WAIT_TIMEOUT_NS
+
+// user_data 低 8 位为请求类型，高位为连接编号
+enum Op : uint64_t {
+    OP_ACCEPT = 1,
+    OP_WAKEUP,
+    OP_RECV,
+    OP_SEND,
+    OP_CANCEL,
+    OP_PROVIDE
+};
+
+uint64_t make_user_data(uint32_t id, Op op) {
+    return (static_cast<uint64_t>(id) << 8) | op;
+}
+}
+
+UringLoop::UringLoop(RequestHandler on_request, CloseHandler on_close, size_t max_body_size)
+    : EventLoop(std::move(on_request), std::move(on_close), max_body_size),
+      ring_fd(-1), sq_entries(0), sq_head(nullptr), sq_tail(nullptr), sq_mask(nullptr),
+      sq_local_tail(0), sqes(nullptr), cq_head(nullptr), cq_tail(nullptr), cq_mask(nullptr),
+      cqes(nullptr), ring_ptr(MAP_FAILED), ring_size(0), sqe_ptr(MAP_FAILED), sqe_size(0),
+      buf_base(nullptr),
+      listen_fd(-1), accept_armed(false), wakeup_armed(false), wakeup_value(0), next_conn_id(1) {
+    try {
+        setup_ring();
+        probe_opcodes();
+        setup_buffers();
+        check_multishot_recv();
+    } catch (...) {
+        release_ring();
+        throw;
+    }
+
+    // io_uring 对 O_NONBLOCK 的 fd 读取会直接返回 EAGAIN，唤醒用的 eventfd 需改为阻塞模式
+    int flags = fcntl(wakeup_fd, F_GETFL, 0);
+    fcntl(wakeup_fd, F_SETFL, flags & ~O_NONBLOCK);
+}
+
+UringLoop::~UringLoop() {
+    release_ring();
+}
+
+void UringLoop::release_ring() {
+    if (ring_fd != -1) {
+        close(ring_fd);
+        ring_fd = -1;
+    }
+    if (sqe_ptr != MAP_FAILED) {
+        munmap(sqe_ptr, sqe_size);
+        sqe_ptr = MAP_FAILED;
+    }
+    if (ring_ptr != MAP_FAILED) {
+        munmap(ring_ptr, ring_size);
+        ring_ptr = MAP_FAILED;
+    }
+    if (buf_base) {
+        munmap(buf_base, BUF_COUNT * BUF_SIZE);
+        buf_base = nullptr;
+    }
+}
+
+void UringLoop::setup_ring() {
+    io_uring_params params{};
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+    params.cq_entries = CQ_ENTRIES;
+    ring_fd = syscall(__NR_io_uring_setup, RING_ENTRIES, &params);
+    if (ring_fd == -1 && errno == EINVAL) {
+        // 旧内核不支持 SUBMIT_ALL / COOP_TASKRUN
+        params = io_uring_params{};
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = CQ_ENTRIES;
+        ring_fd = syscall(__NR_io_uring_setup, RING_ENTRIES, &params);
+    }
+    if (ring_fd == -1) {
+        throw std::runtime_error("io_uring_setup 失败: " + std::string(strerror(errno)));
+    }
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG)) {
+        throw std::runtime_error("内核 io_uring 版本过旧");
+    }
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    ring_size = std::max(sq_size, cq_size);
+    ring_ptr = mmap(nullptr, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ring_fd, IORING_OFF_SQ_RING);
+    if (ring_ptr == MAP_FAILED) {
+        throw std::runtime_error("映射 io_uring 队列失败");
+    }
+    sqe_size = params.sq_entries * sizeof(io_uring_sqe);
+    sqe_ptr = mmap(nullptr, sqe_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ring_fd, IORING_OFF_SQES);
+    if (sqe_ptr == MAP_FAILED) {
+        throw std::runtime_error("映射 io_uring 提交项失败");
+    }
+
+    char* base = static_cast<char*>(ring_ptr);
+    sq_entries = params.sq_entries;
+    sq_head = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+    sq_mask = reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+    sqes = static_cast<io_uring_sqe*>(sqe_ptr);
+    cq_head = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+    cq_mask = reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+
+    // 提交项下标与队列位置一一对应，之后只需推进 tail
+    unsigned* sq_array = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+    for (unsigned i = 0; i < sq_entries; ++i) {
+        sq_array[i] = i;
+    }
+    sq_local_tail = *sq_tail;
+}
+
+void UringLoop::setup_buffers() {
+    // 使用 IORING_OP_PROVIDE_BUFFERS 提供缓冲区：部分内核环境下注册缓冲区队列
+    // （IORING_REGISTER_PBUF_RING）虽然成功，recv 却始终返回 ENOBUFS
+    void* buffers = mmap(nullptr, BUF_COUNT * BUF_SIZE, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffers == MAP_FAILED) {
+        throw std::runtime_error("分配 io_uring 读缓冲区失败");
+    }
+    buf_base = static_cast<char*>(buffers);
+
+    io_uring_sqe* sqe = get_sqe();
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = BUF_COUNT;
+    sqe->addr = reinterpret_cast<uint64_t>(buf_base);
+    sqe->len = BUF_SIZE;
+    sqe->off = 0;
+    sqe->buf_group = BUF_GROUP;
+    sqe->user_data = make_user_data(0, OP_PROVIDE);
+
+    // 同步等待结果，失败时由 EventLoop::create 回退到 epoll
+    io_uring_cqe cqe;
+    if (!wait_completion(cqe)) {
+        throw std::runtime_error("提供 io_uring 读缓冲区失败");
+    }
+    if (cqe.res < 0) {
+        throw std::runtime_error("提供 io_uring 读缓冲区失败: " + std::string(strerror(-cqe.res)));
+    }
+}
+
+void UringLoop::probe_opcodes() {
+    std::vector<char> storage(sizeof(io_uring_probe) + PROBE_OPS * sizeof(io_uring_probe_op));
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+    if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, probe, PROBE_OPS) == -1) {
+        throw std::runtime_error("查询 io_uring 支持的操作失败: " + std::string(strerror(errno)));
+    }
+    for (uint8_t op : {IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SENDMSG, IORING_OP_READ,
+                       IORING_OP_PROVIDE_BUFFERS, IORING_OP_ASYNC_CANCEL}) {
+        if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+            throw std::runtime_error("内核 io_uring 不支持操作 " + std::to_string(op));
+        }
+    }
+}
+
+// 操作码探测看不出 recv 是否支持多次触发和缓冲区选择（旧内核对 IORING_RECV_MULTISHOT 返回 EINVAL），
+// 在一对本地 socket 上实际收一次数据确认
+void UringLoop::check_multishot_recv() {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == -1) {
+        throw std::runtime_error("创建 socketpair 失败: " + std::string(strerror(errno)));
+    }
+    char byte = 0;
+    bool ok = write(fds[1], &byte, 1) == 1;
+    io_uring_sqe* sqe = ok ? get_sqe() : nullptr;
+    if (sqe) {
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = fds[0];
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = BUF_GROUP;
+        sqe->user_data = make_user_data(0, OP_RECV);
+    }
+
+    io_uring_cqe cqe{};
+    ok = sqe && wait_completion(cqe);
+    int res = ok ? cqe.res : 0;
+    bool more = ok && (cqe.flags & IORING_CQE_F_MORE);
+    bool has_buffer = ok && (cqe.flags & IORING_CQE_F_BUFFER);
+    uint16_t bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    if (more) {
+        // 关闭读端后 recv 以 0 结束，不再有后续完成事件
+        shutdown(fds[0], SHUT_RDWR);
+        while ((ok = wait_completion(cqe)) && (cqe.flags & IORING_CQE_F_MORE)) {
+        }
+    }
+    close(fds[0]);
+    close(fds[1]);
+    if (has_buffer) {
+        recycle_buffer(bid);
+    }
+
+    if (res < 0) {
+        throw std::runtime_error("内核 io_uring 不支持多次触发的 recv: " + std::string(strerror(-res)));
+    }
+    if (!ok || res != 1 || !more) {
+        throw std::runtime_error("内核 io_uring 不支持多次触发的 recv");
+    }
+}
+
+bool UringLoop::wait_completion(io_uring_cqe& cqe) {
+    for (int attempt = 0; attempt < SETUP_WAIT_ATTEMPTS; ++attempt) {
+        int ret = submit(true);
+        if (ret < 0 && ret != -EINTR && ret != -ETIME) {
+            return false;
+        }
+        unsigned head = *cq_head;
+        if (head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+            cqe = cqes[head & *cq_mask];
+            __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+            return true;
+        }
+    }
+    return false;
+}
+
+void UringLoop::recycle_buffer(uint16_t bid) {
+    // 缓冲区内容已复制到 read_buffer，归还给内核；与其他请求一起在下一次 io_uring_enter 提交
+    io_uring_sqe* sqe = get_sqe();
+    if (!sqe) {
+        LOG_WARNING("io_uring 提交队列已满，读缓冲区 " + std::to_string(bid) + " 未能归还");
+        return;
+    }
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = 1;
+    sqe->addr = reinterpret_cast<uint64_t>(buf_base + bid * BUF_SIZE);
+    sqe->len = BUF_SIZE;
+    sqe->off = bid;
+    sqe->buf_group = BUF_GROUP;
+    sqe->user_data = make_user_data(0, OP_PROVIDE);
+}
+
+io_uring_sqe* UringLoop::get_sqe() {
+    unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    if (sq_local_tail - head >= sq_entries) {
+        // 提交队列已满，先把已填写的请求交给内核
+        submit(false);
+        head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+        if (sq_local_tail - head >= sq_entries) {
+            return nullptr;
+        }
+    }
+    io_uring_sqe* sqe = &sqes[sq_local_tail & *sq_mask];
+    ++sq_local_tail;
+    std::memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int UringLoop::submit(bool wait) {
+    __atomic_store_n(sq_tail, sq_local_tail, __ATOMIC_RELEASE);
+    unsigned to_submit = sq_local_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    if (!wait && to_submit == 0) {
+        return 0;
+    }
+
+    __kernel_timespec ts{};
+    ts.tv_nsec = WAIT_TIMEOUT_NS;
+    io_uring_getevents_arg arg{};
+    arg.ts = reinterpret_cast<uint64_t>(&ts);
+
+    unsigned flags = wait ? (IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG) : 0;
+    int ret = syscall(__NR_io_uring_enter, ring_fd, to_submit, wait ? 1 : 0, flags,
+                      wait ? &arg : nullptr, wait ? sizeof(arg) : 0);
+    ++stats.syscalls;
+    return ret == -1 ? -errno : ret;
+}
+
+void UringLoop::reap_completions() {
+    unsigned head = *cq_head;
+    while (head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+        // 先复制再归还位置，处理过程中可能再次进入内核
+        io_uring_cqe cqe = cqes[head & *cq_mask];
+        ++head;
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+        handle_completion(cqe);
+    }
+}
+
+void UringLoop::add_listener(int fd, AcceptHandler handler) {
+    listen_fd = fd;
+    on_accept = std::move(handler);
+    arm_accept();
+    if (!accept_armed) {
+        throw std::runtime_error("注册监听socket失败");
+    }
+}
+
+void UringLoop::remove_listener() {
+    if (listen_fd == -1) {
+        return;
+    }
+    listen_fd = -1;  // 不再重新提交 accept
+    if (!accept_armed) {
+        return;
+    }
+    io_uring_sqe* sqe = get_sqe();
+    if (!sqe) {
+        LOG_WARNING("io_uring 提交队列已满，无法取消 accept");
+        return;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = make_user_data(0, OP_ACCEPT);
+    sqe->user_data = make_user_data(0, OP_CANCEL);
+}
+
+void UringLoop::run() {
+    running = true;
+
+    while (running && g_running) {
+        if (!wakeup_armed) {
+            arm_wakeup();
+        }
+        if (listen_fd != -1 && !accept_armed) {
+            arm_accept();
+        }
+
+        int ret = submit(true);
+        if (ret < 0 && ret != -EINTR && ret != -ETIME && ret != -EBUSY && ret != -EAGAIN) {
+            LOG_ERROR("io_uring_enter 失败: " + std::to_string(-ret));
+            break;
+        }
+        reap_completions();
+    }
+
+    // 退出前处理已投递的任务，避免连接 fd 泄漏
+    run_pending_tasks();
+    running = false;
+}
+
+void UringLoop::arm_accept() {
+    io_uring_sqe* sqe = get_sqe();
+    if (!sqe) {
+        accept_armed = false;
+        return;
+    }
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = make_user_data(0, OP_ACCEPT);
+    accept_armed = true;
+}
+
+void UringLoop::arm_wakeup() {
+    io_uring_sqe* sqe = get_sqe();
+    if (!sqe) {
+        return;
+    }
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = wakeup_fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&wakeup_value);
+    sqe->len = sizeof(wakeup_value);
+    sqe->user_data = make_user_data(0, OP_WAKEUP);
+    wakeup_armed = true;
+}
+
+void UringLoop::arm_recv(const UringConnectionPtr& conn) {
+    io_uring_sqe* sqe = get_sqe();
+    if (!sqe) {
+        LOG_WARNING("io_uring 提交队列已满，关闭连接，fd: " + std::to_string(conn->fd));
+        close_connection(conn);
+        return;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn->fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUF_GROUP;
+    sqe->user_data = make_user_data(conn->id, OP_RECV);
+    conn->recv_armed = true;
+    ++conn->pending_ops;
+}
+
+void UringLoop::cancel_recv(const UringConnectionPtr& conn) {
+    io_uring_sqe* sqe = get_sqe();
+    if (!sqe) {
+        return;  // 取消失败时继续读取，暂停前多缓冲一些数据
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = make_user_data(conn->id, OP_RECV);
+    sqe->user_data = make_user_data(0, OP_CANCEL);
+}
+
+void UringLoop::handle_completion(const io_uring_cqe& cqe) {
+    Op op = static_cast<Op>(cqe.user_data & 0xff);
+    uint32_t id = static_cast<uint32_t>(cqe.user_data >> 8);
+
+    switch (op) {
+        case OP_ACCEPT:
+            if (!(cqe.flags & IORING_CQE_F_MORE)) {
+                accept_armed = false;  // 下一轮循环重新提交
+            }
+            if (cqe.res >= 0) {
+                accept_connection(cqe.res);
+            } else if (cqe.res != -EAGAIN && cqe.res != -EINTR && cqe.res != -ECONNABORTED &&
+                       cqe.res != -ECANCELED) {
+                LOG_WARNING("accept 失败: " + std::to_string(-cqe.res));
+            }
+            return;
+        case OP_WAKEUP:
+            wakeup_armed = false;
+            run_pending_tasks();
+            return;
+        case OP_PROVIDE:
+            if (cqe.res < 0) {
+                LOG_WARNING("归还 io_uring 读缓冲区失败: " + std::to_string(-cqe.res));
+            }
+            return;
+        case OP_RECV:
+        case OP_SEND:
+            break;
+        default:
+            return;
+    }
+
+    auto it = conns_by_id.find(id);
+    if (it == conns_by_id.end()) {
+        if (cqe.flags & IORING_CQE_F_BUFFER) {
+            recycle_buffer(static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+        }
+        return;
+    }
+    UringConnectionPtr conn = it->second;
+    if (op == OP_SEND || !(cqe.flags & IORING_CQE_F_MORE)) {
+        --conn->pending_ops;
+    }
+
+    if (op == OP_RECV) {
+        handle_recv(conn, cqe);
+    } else {
+        handle_send(conn, cqe);
+    }
+
+    if (conn->closed && conn->pending_ops == 0) {
+        conns_by_id.erase(id);
+    }
+}
+
+void UringLoop::handle_recv(const UringConnectionPtr& conn, const io_uring_cqe& cqe) {
+    if (!(cqe.flags & IORING_CQE_F_MORE)) {
+        conn->recv_armed = false;
+    }
+
+    if (cqe.res > 0) {
+        uint16_t bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        if (!conn->closed) {
+            append_read_data(conn, buf_base + bid * BUF_SIZE, cqe.res);
+        }
+        recycle_buffer(bid);
+        if (conn->closed) {
+            return;
+        }
+
+        if (!conn->read_paused && conn->read_buffer.size() >= max_buffered()) {
+            // 暂停读取，等待已有请求处理完；取消生效前到达的数据照常追加
+            conn->read_paused = true;
+            if (conn->recv_armed) {
+                cancel_recv(conn);
+            }
+        }
+        on_read(conn);
+        if (!conn->closed && !conn->recv_armed && !conn->read_paused) {
+            arm_recv(conn);
+        }
+        return;
+    }
+
+    if (conn->closed) {
+        return;
+    }
+    if (cqe.res == 0) {
+        conn->peer_closed = true;
+        on_read(conn);
+        return;
+    }
+    if (cqe.res == -ENOBUFS || cqe.res == -ECANCELED || cqe.res == -EINTR) {
+        // 共享缓冲区暂时用完或读取被暂停，需要时重新提交
+        if (!conn->recv_armed && !conn->read_paused) {
+            arm_recv(conn);
+        }
+        return;
+    }
+    close_connection(conn);
+}
+
+void UringLoop::resume_read(const ConnectionPtr& conn) {
+    auto uconn = std::static_pointer_cast<UringConnection>(conn);
+    uconn->read_paused = false;
+    if (!uconn->recv_armed && !uconn->peer_closed) {
+        arm_recv(uconn);
+    }
+}
+
+void UringLoop::register_connection(int client_fd) {
+    if (!running && !g_running) {
+        close(client_fd);
+        return;
+    }
+
+    int opt = 1;
+    setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    ++stats.syscalls;
+
+    uint32_t id = next_conn_id++;
+    if (next_conn_id == 0) {
+        next_conn_id = 1;  // 0 留给不属于连接的请求
+    }
+    auto conn = std::make_shared<UringConnection>(client_fd, this, id);
+    conns_by_id[id] = conn;
+    add_to_loop(conn);
+    arm_recv(conn);
+}
+
+void UringLoop::flush(const ConnectionPtr& conn) {
+    auto uconn = std::static_pointer_cast<UringConnection>(conn);
+    if (uconn->closed || uconn->sending) {
+        return;  // 上一次发送完成后会继续发送剩余数据
+    }
+    if (uconn->write_queue.empty()) {
+        on_write_drained(conn);
+        return;
+    }
+
+    // 把排队的多个响应合并成一次 sendmsg；发送完成前 write_queue 中的数据保持不变。
+    // 每个连接同时只有一个 sendmsg，不用 IOSQE_IO_LINK 串联：链中的 sendmsg 部分发送时内核会取消
+    // 后续请求，剩余数据仍要等完成事件后重新提交；发送后关闭连接时链上 close 会与
+    // release_connection 争用同一个 fd
+    uconn->iov.clear();
+    for (auto it = uconn->write_queue.begin();
+         it != uconn->write_queue.end() && uconn->iov.size() + HttpResponse::IOV_COUNT <= MAX_IOV; ++it) {
+        iovec parts[HttpResponse::IOV_COUNT];
+        size_t count = it->fill_iovec(parts, it == uconn->write_queue.begin() ? uconn->write_offset : 0);
+        uconn->iov.insert(uconn->iov.end(), parts, parts + count);
+    }
+    uconn->msg = msghdr{};
+    uconn->msg.msg_iov = uconn->iov.data();
+    uconn->msg.msg_iovlen = uconn->iov.size();
+
+    io_uring_sqe* sqe = get_sqe();
+    if (!sqe) {
+        LOG_WARNING("io_uring 提交队列已满，关闭连接，fd: " + std::to_string(conn->fd));
+        close_connection(conn);
+        return;
+    }
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = uconn->fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&uconn->msg);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = make_user_data(uconn->id, OP_SEND);
+    uconn->sending = true;
+    ++uconn->pending_ops;
+}
+
+void UringLoop::handle_send(const UringConnectionPtr& conn, const io_uring_cqe& cqe) {
+    conn->sending = false;
+    if (conn->closed) {
+        return;
+    }
+    if (cqe.res < 0) {
+        if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+            flush(conn);
+            return;
+        }
+        close_connection(conn);
+        return;
+    }
+
+    // 部分发送时继续提交剩余数据
+    consume_written(conn, cqe.res);
+    flush(conn);
+}
+
+void UringLoop::release_connection(const ConnectionPtr& conn) {
+    auto uconn = std::static_pointer_cast<UringConnection>(conn);
+    // shutdown 让未完成的 recv / sendmsg 尽快结束，连接对象在它们全部完成后释放
+    shutdown(uconn->fd, SHUT_RDWR);
+    close(uconn->fd);
+    stats.syscalls += 2;
+    if (uconn->pending_ops == 0) {
+        conns_by_id.erase(uconn->id);
+    }
+}
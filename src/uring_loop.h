@@ -0,0 +1,95 @@
+#ifndef URING_LOOP_H
+#define URING_LOOP_H
+
+#include "event_loop.h"
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <vector>
+
+// 基于 io_uring 的事件循环（直接使用系统调用，不依赖 liburing）
+// 多次触发的 accept / recv 请求只需提交一次；recv 使用内核选择的共享缓冲区，
+// 空闲连接不占用读缓冲；每轮循环的提交和收割合并为一次 io_uring_enter
+class UringLoop : public EventLoop {
+public:
+    UringLoop(RequestHandler on_request, CloseHandler on_close, size_t max_body_size);
+    ~UringLoop() override;
+
+    void add_listener(int listen_fd, AcceptHandler on_accept) override;
+    void run() override;
+    const char* backend_name() const override { return "io_uring"; }
+
+protected:
+    void register_connection(int client_fd) override;
+    void flush(const ConnectionPtr& conn) override;
+    void resume_read(const ConnectionPtr& conn) override;
+    void release_connection(const ConnectionPtr& conn) override;
+    void remove_listener() override;
+
+private:
+    // 连接上还有未完成的 io_uring 请求时，内核仍会访问 msg / iov，
+    // 因此关闭后要等所有请求完成才能释放
+    struct UringConnection : Connection {
+        uint32_t id;
+        int pending_ops;
+        bool recv_armed;
+        bool sending;
+        msghdr msg;
+        std::vector<iovec> iov;
+
+        UringConnection(int fd, EventLoop* loop, uint32_t id)
+            : Connection(fd, loop), id(id), pending_ops(0), recv_armed(false), sending(false), msg{} {}
+    };
+    using UringConnectionPtr = std::shared_ptr<UringConnection>;
+
+    // 提交队列
+    int ring_fd;
+    unsigned sq_entries;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned sq_local_tail;  // 已填写但尚未提交给内核的位置
+    io_uring_sqe* sqes;
+    // 完成队列
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    io_uring_cqe* cqes;
+    void* ring_ptr;
+    size_t ring_size;
+    void* sqe_ptr;
+    size_t sqe_size;
+
+    // recv 使用的共享缓冲区，由内核按需选取
+    char* buf_base;
+
+    int listen_fd;
+    bool accept_armed;
+    bool wakeup_armed;
+    uint64_t wakeup_value;
+    uint32_t next_conn_id;
+    std::unordered_map<uint32_t, UringConnectionPtr> conns_by_id;
+
+    void setup_ring();
+    void release_ring();
+    void setup_buffers();
+    // 初始化时检查内核支持，不支持时抛出异常，由 EventLoop::create 回退到 epoll
+    void probe_opcodes();
+    void check_multishot_recv();
+    // 初始化阶段同步等待一个完成事件，超时或出错时返回 false
+    bool wait_completion(io_uring_cqe& cqe);
+    io_uring_sqe* get_sqe();
+    int submit(bool wait);
+    void reap_completions();
+    void handle_completion(const io_uring_cqe& cqe);
+
+    void arm_accept();
+    void arm_wakeup();
+    void arm_recv(const UringConnectionPtr& conn);
+    void cancel_recv(const UringConnectionPtr& conn);
+    void handle_recv(const UringConnectionPtr& conn, const io_uring_cqe& cqe);
+    void handle_send(const UringConnectionPtr& conn, const io_uring_cqe& cqe);
+    void recycle_buffer(uint16_t bid);
+};
+
+#endif // URING_LOOP_H
@@ -0,0 +1,206 @@
+#include "user_directory.h"
+#include <cstring>
+#include <mutex>
+
+// 最小表容量，空目录也不为零，探测时不需要判断
+static const size_t MIN_SLOTS = 64;
+
+UserDirectory::UserDirectory() : count(0) {
+    rebuild(MIN_SLOTS);
+}
+
+void UserDirectory::reserve(size_t users) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    size_t needed = users * 10 / 7 + 1;
+    if (needed > id_slots.size()) {
+        rebuild(needed);
+    }
+}
+
+bool UserDirectory::add(int user_id, std::string_view username) {
+    if (user_id < 0 || username.empty() || username.size() > MAX_NAME_LENGTH) {
+        return false;
+    }
+    uint64_t hash = hash_name(username);
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (find_id(user_id) != EMPTY || (bloom_test(hash) && find_name(username, hash) != EMPTY)) {
+        return false;
+    }
+    // 装载率超过 0.7 时容量翻倍
+    if ((count + 1) * 10 > id_slots.size() * 7) {
+        rebuild(id_slots.size() * 2);
+    }
+
+    uint32_t offset = static_cast<uint32_t>(records.size());
+    int32_t id = user_id;
+    records.resize(records.size() + sizeof(id) + 1 + username.size());
+    char* record = records.data() + offset;
+    std::memcpy(record, &id, sizeof(id));
+    record[sizeof(id)] = static_cast<char>(username.size());
+    std::memcpy(record + sizeof(id) + 1, username.data(), username.size());
+
+    insert_slots(offset, hash);
+    ++count;
+    return true;
+}
+
+std::string UserDirectory::username(int user_id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    uint32_t offset = find_id(user_id);
+    return offset == EMPTY ? std::string() : std::string(record_name(offset));
+}
+
+int UserDirectory::user_id(std::string_view username) const {
+    uint64_t hash = hash_name(username);
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    if (!bloom_test(hash)) {
+        return -1;
+    }
+    uint32_t offset = find_name(username, hash);
+    return offset == EMPTY ? -1 : record_id(offset);
+}
+
+bool UserDirectory::contains(std::string_view username) const {
+    return user_id(username) != -1;
+}
+
+bool UserDirectory::might_contain(std::string_view username) const {
+    uint64_t hash = hash_name(username);
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return bloom_test(hash);
+}
+
+size_t UserDirectory::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return count;
+}
+
+size_t UserDirectory::memory_bytes() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return records.capacity() + (id_slots.capacity() + name_slots.capacity()) * sizeof(Slot) +
+           bloom.capacity() * sizeof(uint64_t);
+}
+
+// FNV-1a 之后再做一次 64 位混合，短用户名的高位也分布均匀
+uint64_t UserDirectory::hash_name(std::string_view name) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : name) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// 用户ID基本连续，乘以黄金分割常数后取高位打散
+size_t UserDirectory::id_index(uint32_t user_id, size_t mask) {
+    return static_cast<size_t>((user_id * 0x9e3779b97f4a7c15ull) >> 32) & mask;
+}
+
+int UserDirectory::record_id(uint32_t offset) const {
+    int32_t id;
+    std::memcpy(&id, records.data() + offset, sizeof(id));
+    return id;
+}
+
+std::string_view UserDirectory::record_name(uint32_t offset) const {
+    const char* record = records.data() + offset;
+    size_t length = static_cast<unsigned char>(record[sizeof(int32_t)]);
+    return std::string_view(record + sizeof(int32_t) + 1, length);
+}
+
+uint32_t UserDirectory::find_id(int user_id) const {
+    size_t mask = id_slots.size() - 1;
+    for (size_t i = id_index(static_cast<uint32_t>(user_id), mask);; i = (i + 1) & mask) {
+        const Slot& slot = id_slots[i];
+        if (slot.offset == EMPTY) {
+            return EMPTY;
+        }
+        if (slot.key == static_cast<uint32_t>(user_id)) {
+            return slot.offset;
+        }
+    }
+}
+
+uint32_t UserDirectory::find_name(std::string_view name, uint64_t hash) const {
+    size_t mask = name_slots.size() - 1;
+    uint32_t tag = static_cast<uint32_t>(hash >> 32);
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        const Slot& slot = name_slots[i];
+        if (slot.offset == EMPTY) {
+            return EMPTY;
+        }
+        // 先比较哈希值高位，相同时才读取记录比较用户名
+        if (slot.key == tag && record_name(slot.offset) == name) {
+            return slot.offset;
+        }
+    }
+}
+
+// 双重哈希：第 i 个位置为 h1 + i * h2
+bool UserDirectory::bloom_test(uint64_t hash) const {
+    size_t mask = bloom.size() * 64 - 1;
+    uint64_t h1 = hash;
+    uint64_t h2 = (hash >> 29) | 1;
+    for (int i = 0; i < BLOOM_HASHES; ++i) {
+        size_t bit = (h1 + i * h2) & mask;
+        if (!(bloom[bit >> 6] & (1ull << (bit & 63)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void UserDirectory::bloom_set(uint64_t hash) {
+    size_t mask = bloom.size() * 64 - 1;
+    uint64_t h1 = hash;
+    uint64_t h2 = (hash >> 29) | 1;
+    for (int i = 0; i < BLOOM_HASHES; ++i) {
+        size_t bit = (h1 + i * h2) & mask;
+        bloom[bit >> 6] |= 1ull << (bit & 63);
+    }
+}
+
+void UserDirectory::rebuild(size_t capacity) {
+    size_t slots = MIN_SLOTS;
+    while (slots < capacity) {
+        slots <<= 1;
+    }
+    // 表按 0.7 装载率扩容，每个用户约 10 位即可换算为表容量的 7 倍
+    size_t bloom_bits = slots * 7 / 10 * BLOOM_BITS_PER_USER;
+    size_t bloom_words = 1;
+    while (bloom_words * 64 < bloom_bits) {
+        bloom_words <<= 1;
+    }
+
+    id_slots.assign(slots, Slot{0, EMPTY});
+    name_slots.assign(slots, Slot{0, EMPTY});
+    bloom.assign(bloom_words, 0);
+    records.reserve(records.size() + (slots * 7 / 10 - count) * 16);
+
+    for (size_t offset = 0; offset < records.size();) {
+        std::string_view name = record_name(static_cast<uint32_t>(offset));
+        insert_slots(static_cast<uint32_t>(offset), hash_name(name));
+        offset += sizeof(int32_t) + 1 + name.size();
+    }
+}
+
+void UserDirectory::insert_slots(uint32_t offset, uint64_t hash) {
+    size_t mask = id_slots.size() - 1;
+    uint32_t id = static_cast<uint32_t>(record_id(offset));
+    size_t i = id_index(id, mask);
+    while (id_slots[i].offset != EMPTY) {
+        i = (i + 1) & mask;
+    }
+    id_slots[i] = Slot{id, offset};
+
+    i = hash & mask;
+    while (name_slots[i].offset != EMPTY) {
+        i = (i + 1) & mask;
+    }
+    name_slots[i] = Slot{static_cast<uint32_t>(hash >> 32), offset};
+
+    bloom_set(hash);
+}
@@ -0,0 +1,70 @@
+#ifndef USER_DIRECTORY_H
+#define USER_DIRECTORY_H
+
+#include <cstdint>
+#include <cstddef>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 进程内的用户目录：启动时载入全部用户，注册时追加，
+// 用户ID与用户名的双向查找和用户名是否存在的判断都不需要访问数据库
+//
+// 用户名依次存放在一块连续内存中，每条记录为 4 字节用户ID + 1 字节长度 + 用户名；
+// 两张开放寻址表（线性探测，容量为 2 的幂，装载率不超过 0.7）的槽只有 8 字节：
+// ID 表为 (用户ID, 记录偏移)，用户名表为 (哈希值高 32 位, 记录偏移)。
+// 布隆过滤器每个用户约 10 位、误判率约 1%，不存在的用户名大多读几个位就能判定
+// 读多写少，用读写锁保护
+class UserDirectory {
+public:
+    UserDirectory();
+
+    // 预留 users 个用户的容量，避免载入时逐步扩容
+    void reserve(size_t users);
+    // 添加用户，用户ID或用户名已存在时返回 false
+    bool add(int user_id, std::string_view username);
+
+    std::string username(int user_id) const;        // 不存在时返回空字符串
+    int user_id(std::string_view username) const;   // 不存在时返回 -1
+    bool contains(std::string_view username) const;
+    // 只查布隆过滤器：false 表示一定不存在，true 表示可能存在
+    bool might_contain(std::string_view username) const;
+
+    size_t size() const;
+    size_t memory_bytes() const;  // 名称存储、两张表和布隆过滤器占用的字节数
+
+private:
+    static const uint32_t EMPTY = UINT32_MAX;
+    static const int BLOOM_HASHES = 7;
+    static const size_t BLOOM_BITS_PER_USER = 10;
+    static const size_t MAX_NAME_LENGTH = 255;
+
+    struct Slot {
+        uint32_t key;     // ID 表为用户ID，用户名表为哈希值高 32 位
+        uint32_t offset;  // 记录在 records 中的偏移，EMPTY 表示空槽
+    };
+
+    std::vector<char> records;
+    std::vector<Slot> id_slots;
+    std::vector<Slot> name_slots;
+    std::vector<uint64_t> bloom;
+    size_t count;
+    mutable std::shared_mutex mutex;
+
+    static uint64_t hash_name(std::string_view name);
+    static size_t id_index(uint32_t user_id, size_t mask);
+
+    int record_id(uint32_t offset) const;
+    std::string_view record_name(uint32_t offset) const;
+    // 调用方持有锁
+    uint32_t find_id(int user_id) const;
+    uint32_t find_name(std::string_view name, uint64_t hash) const;
+    bool bloom_test(uint64_t hash) const;
+    void bloom_set(uint64_t hash);
+    // 把两张表扩大到至少 capacity 个槽并按已有记录重建，布隆过滤器随之重建
+    void rebuild(size_t capacity);
+    void insert_slots(uint32_t offset, uint64_t hash);
+};
+
+#endif // USER_DIRECTORY_H
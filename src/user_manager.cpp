@@ -1,18 +1,36 @@
 #include "user_manager.h"
 #include "database.h"
+#include "group_fanout.h"
+#include "push_hub.h"
 #include "common.h"
 #include "logger.h"
 #include <iostream>
-#include <random>
 #include <algorithm>
+#include <chrono>
+#include <ctime>
 
-UserManager::UserManager(Database* db) : db(db) {
+static uint64_t steady_now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+UserManager::UserManager(Database* db, GroupFanout* group_fanout, PushHub* push_hub)
+    : db(db), group_fanout(group_fanout), push_hub(push_hub),
+      sessions(SESSION_SHARDS, SESSION_TIMER_TICK_MS, steady_now_ms()) {
+    sessions.set_ttl(DEFAULT_SESSION_TTL_SECONDS * 1000ull);
+    auto start = std::chrono::steady_clock::now();
+    db->for_each_user([this](int user_id, std::string_view username) {
+        directory.add(user_id, username);
+    });
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    LOG_INFO("用户目录载入 " + std::to_string(directory.size()) + " 个用户，耗时 " +
+             std::to_string(elapsed.count()) + " ms，占用 " + std::to_string(directory.memory_bytes() / 1024) + " KB");
 }
 
 UserManager::~UserManager() {
 }
 
-std::string UserManager::register_user(const std::string& body) {
+HttpResponse UserManager::register_user(std::string_view body) {
     std::string username = parse_json_value(body, "username");
     std::string password = parse_json_value(body, "password");
     
@@ -36,20 +54,25 @@ std::string UserManager::register_user(const std::string& body) {
         }
     }
     
-    if (db->user_exists(username)) {
+    if (directory.contains(username)) {
         return create_json_response("error", "用户名已存在");
     }
     
-    if (db->create_user(username, password)) {
+    int user_id;
+    if (db->create_user(username, password, user_id)) {
+        directory.add(user_id, username);
         LOG_INFO("新用户注册: " + username);
         return create_json_response("success", "注册成功");
-    } else {
-        LOG_ERROR("用户注册失败: " + username);
-        return create_json_response("error", "注册失败");
     }
+    // 同名用户并发注册时由数据库的唯一约束拦下，这里再确认一次原因
+    if (db->user_exists(username)) {
+        return create_json_response("error", "用户名已存在");
+    }
+    LOG_ERROR("用户注册失败: " + username);
+    return create_json_response("error", "注册失败");
 }
 
-std::string UserManager::login_user(const std::string& body, int client_fd) {
+HttpResponse UserManager::login_user(std::string_view body, int client_fd) {
     std::string username = parse_json_value(body, "username");
     std::string password = parse_json_value(body, "password");
     
@@ -61,22 +84,32 @@ std::string UserManager::login_user(const std::string& body, int client_fd) {
     if (!db->verify_user(username, password, user)) {
         return create_json_response("error", "用户名或密码错误");
     }
+    // 平滑升级期间旧进程注册的用户不在本进程的目录中，登录时补上
+    directory.add(user.user_id, user.username);
     
-    std::lock_guard<std::mutex> lock(users_mutex);
-    
-    // 生成token
-    std::string token = generate_token();
+    // 群消息只推送给在线成员，登录时载入用户所在的群组
+    std::vector<int> group_ids;
+    for (const Group& group : db->get_user_groups(user.user_id)) {
+        group_ids.push_back(group.group_id);
+    }
     
-    // 更新用户信息
+    // 重复登录沿用原来的会话定时器，之前的 token 仍然有效（最多保留最近的 SessionTable::MAX_TOKENS_PER_USER 个）
     user.online = true;
     user.socket_fd = client_fd;
-    user.token = token;
-    online_users[user.user_id] = user;
-    
-    // 存储token到用户ID的映射
-    token_to_user_id[token] = user.user_id;
+    user.last_seen = std::time(nullptr);
+    bool was_online;
+    // 在会话分片的锁内加入群组扇出，与并发的过期、登出移出扇出的顺序和会话表一致
+    std::string token = sessions.login(user, was_online, [this, &user, &group_ids]() {
+        group_fanout->user_online(user.user_id, group_ids);
+    });
+    if (token.empty()) {
+        return create_json_response("error", "登录失败，请稍后重试");
+    }
     
     LOG_INFO("用户登录成功: " + username + " (ID: " + std::to_string(user.user_id) + ")");
+    if (!was_online) {
+        publish_presence(user, true);
+    }
     
     // 返回登录成功的用户信息（包含token）
     std::string data = "{\"user_id\":" + std::to_string(user.user_id) + 
@@ -86,7 +119,7 @@ std::string UserManager::login_user(const std::string& body, int client_fd) {
     return create_json_response("success", data);
 }
 
-std::string UserManager::logout_user(const std::string& body, int client_fd) {
+HttpResponse UserManager::logout_user(std::string_view body, int client_fd) {
     (void)client_fd;  // 参数未使用，保留为了接口兼容性
     std::string username = parse_json_value(body, "username");
     
@@ -99,64 +132,32 @@ std::string UserManager::logout_user(const std::string& body, int client_fd) {
         return create_json_response("error", "无效的用户名");
     }
     
-    std::lock_guard<std::mutex> lock(users_mutex);
-    
-    if (online_users.find(user_id) != online_users.end()) {
-        // 移除token映射
-        std::string token = online_users[user_id].token;
-        if (!token.empty()) {
-            token_to_user_id.erase(token);
-        }
-        
-        online_users[user_id].online = false;
-        online_users.erase(user_id);
-        
-        LOG_INFO("用户登出: " + username + " (ID: " + std::to_string(user_id) + ")");
+    // 登出结束整个会话，移除该用户的所有 token
+    User user;
+    if (!sessions.logout(user_id, user)) {
+        return create_json_response("success", "登出成功");
     }
     
+    LOG_INFO("用户登出: " + username + " (ID: " + std::to_string(user_id) + ")");
+    publish_presence(user, false);
+    
     return create_json_response("success", "登出成功");
 }
 
-int UserManager::get_user_id_by_token(const std::string& token) {
-    std::lock_guard<std::mutex> lock(users_mutex);
-    
-    auto it = token_to_user_id.find(token);
-    if (it != token_to_user_id.end()) {
-        return it->second;
-    }
-    
-    return -1;
+int UserManager::authenticate(std::string_view token, std::string_view username) {
+    return sessions.authenticate(token, username);
 }
 
-int UserManager::get_user_id_by_fd(int client_fd) {
-    std::lock_guard<std::mutex> lock(users_mutex);
-    
-    for (const auto& pair : online_users) {
-        if (pair.second.socket_fd == client_fd) {
-            return pair.first;
-        }
-    }
-    
-    return -1;
+int UserManager::authenticate(std::string_view token) {
+    return sessions.authenticate(token);
 }
 
-std::string UserManager::generate_token() {
-    static const char alphanum[] =
-        "0123456789"
-        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-        "abcdefghijklmnopqrstuvwxyz";
-        
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(0, sizeof(alphanum) - 2);
-    
-    std::string token;
-    token.reserve(32);
-    for (int i = 0; i < 32; ++i) {
-        token += alphanum[dis(gen)];
-    }
-    
-    return token;
+int UserManager::get_user_id_by_token(const std::string& token) {
+    return sessions.find_token(token);
+}
+
+int UserManager::get_user_id_by_fd(int client_fd) {
+    return sessions.find_fd(client_fd);
 }
 
 bool UserManager::is_valid_token(const std::string& token) {
@@ -164,44 +165,43 @@ bool UserManager::is_valid_token(const std::string& token) {
 }
 
 bool UserManager::is_user_online(int user_id) {
-    std::lock_guard<std::mutex> lock(users_mutex);
-    return online_users.find(user_id) != online_users.end();
+    return sessions.online(user_id);
 }
 
-void UserManager::remove_online_user_by_fd(int client_fd) {
-    std::lock_guard<std::mutex> lock(users_mutex);
-    for (auto it = online_users.begin(); it != online_users.end(); ++it) {
-        if (it->second.socket_fd == client_fd) {
-            online_users.erase(it);
-            break;
-        }
-    }
+void UserManager::set_session_ttl(int ttl_seconds) {
+    sessions.set_ttl(static_cast<uint64_t>(std::max(1, ttl_seconds)) * 1000);
 }
 
-std::unordered_map<int, User>& UserManager::get_online_users() {
-    return online_users;
+void UserManager::expire_sessions() {
+    std::vector<User> expired_users;
+    // 推送连接上的 ping 和事件不经过认证，连接还在就说明客户端仍然在线
+    sessions.expire(steady_now_ms(), [this](int user_id) { return push_hub->has_session(user_id); },
+                    expired_users);
+    
+    for (const User& user : expired_users) {
+        LOG_INFO("会话过期: " + user.username + " (ID: " + std::to_string(user.user_id) + ")");
+        publish_presence(user, false);
+    }
 }
 
-std::mutex& UserManager::get_users_mutex() {
-    return users_mutex;
+void UserManager::publish_presence(const User& user, bool online) {
+    std::string data = "{\"user_id\":" + std::to_string(user.user_id) +
+                       ",\"username\":\"" + user.username +
+                       "\",\"online\":" + (online ? "true" : "false") +
+                       ",\"last_seen\":" + std::to_string(user.last_seen) + "}";
+    group_fanout->publish_to_peers(user.user_id, PushEvent{"presence", 0, data});
+    if (!online) {
+        // 会话移除之后可能已有新的登录加入了扇出，在分片锁内确认仍然没有会话才移出
+        sessions.run_if_offline(user.user_id, [this, &user]() {
+            group_fanout->user_offline(user.user_id);
+        });
+    }
 }
 
 // 新增：获取用户信息API实现
-std::string UserManager::get_user_profile(const std::string& query_string) {
+HttpResponse UserManager::get_user_profile(std::string_view query_string) {
     // 解析查询参数中的username
-    std::string username = "";
-    if (!query_string.empty()) {
-        std::string search_key = "username=";
-        size_t pos = query_string.find(search_key);
-        if (pos != std::string::npos) {
-            pos += search_key.length();
-            size_t end = query_string.find('&', pos);
-            if (end == std::string::npos) {
-                end = query_string.length();
-            }
-            username = query_string.substr(pos, end - pos);
-        }
-    }
+    std::string username(get_query_param(query_string, "username"));
     
     if (username.empty()) {
         return create_json_response("error", "用户名不能为空");
@@ -212,10 +212,8 @@ std::string UserManager::get_user_profile(const std::string& query_string) {
         return create_json_response("error", "无效的用户名");
     }
     
-    std::lock_guard<std::mutex> lock(users_mutex);
-    auto it = online_users.find(user_id);
-    if (it != online_users.end()) {
-        const User& user = it->second;
+    User user;
+    if (sessions.find(user_id, user)) {
         std::string data = "{\"user_id\":" + std::to_string(user.user_id) + 
                           ",\"username\":\"" + user.username + "\"}";
         return create_json_response("success", data);
@@ -225,25 +223,22 @@ std::string UserManager::get_user_profile(const std::string& query_string) {
 }
 
 std::string UserManager::get_username_by_id(int user_id) {
-    // 首先检查在线用户
-    std::lock_guard<std::mutex> lock(users_mutex);
-    auto it = online_users.find(user_id);
-    if (it != online_users.end()) {
-        return it->second.username;
+    std::string username = directory.username(user_id);
+    if (username.empty()) {
+        // 目录之外的用户（如平滑升级期间由旧进程注册）查数据库后补上
+        username = db->get_username_by_id(user_id);
+        if (!username.empty()) {
+            directory.add(user_id, username);
+        }
     }
-    
-    // 如果不在线，从数据库查询
-    return db->get_username_by_id(user_id);
+    return username;
 }
 
 int UserManager::get_user_id_by_username(const std::string& username) {
-    std::lock_guard<std::mutex> lock(users_mutex);
-    
-    for (const auto& pair : online_users) {
-        if (pair.second.username == username && pair.second.online) {
-            return pair.first;
-        }
+    int user_id = directory.user_id(username);
+    if (user_id == -1) {
+        return -1;
     }
     
-    return -1;
+    return sessions.online(user_id) ? user_id : -1;
 }
@@ -2,45 +2,65 @@
 #define USER_MANAGER_H
 
 #include "common.h"
+#include "session_table.h"
+#include "user_directory.h"
 #include <string>
-#include <unordered_map>
-#include <mutex>
-#include <memory>
+#include <string_view>
 
 // 前向声明
 class Database;
+class GroupFanout;
+class PushHub;
+
+// 会话默认有效期（秒）：超过这段时间没有心跳或认证请求的会话被移除
+const int DEFAULT_SESSION_TTL_SECONDS = 300;
+// 会话定时器的精度（毫秒）
+const uint32_t SESSION_TIMER_TICK_MS = 1000;
+// 会话表的分片数，每个分片一把锁
+const size_t SESSION_SHARDS = 16;
 
 class UserManager {
 public:
-    UserManager(Database* db);
+    UserManager(Database* db, GroupFanout* group_fanout, PushHub* push_hub);
     ~UserManager();
     
     // 用户管理API
-    std::string register_user(const std::string& body);
-    std::string login_user(const std::string& body, int client_fd);
-    std::string logout_user(const std::string& body, int client_fd);
+    HttpResponse register_user(std::string_view body);
+    HttpResponse login_user(std::string_view body, int client_fd);
+    HttpResponse logout_user(std::string_view body, int client_fd);
     
     // 新增：获取用户信息API
-    std::string get_user_profile(const std::string& query_string);
+    HttpResponse get_user_profile(std::string_view query_string);
+    // 先查用户目录；目录中没有时（如平滑升级期间由旧进程注册的用户）查数据库并补进目录
     std::string get_username_by_id(int user_id);
     
+    // 认证：token 有效且属于 username 时返回用户ID并推迟会话过期，否则返回 -1；
+    // 只锁 token 所在的一个会话分片
+    int authenticate(std::string_view token, std::string_view username);
+    int authenticate(std::string_view token);  // 推送连接只带 token
+    
     // 工具函数
     int get_user_id_by_token(const std::string& token);
-    int get_user_id_by_username(const std::string& username);  // 新增：通过用户名获取用户ID
+    int get_user_id_by_username(const std::string& username);  // 在线用户的ID，不在线时返回 -1
     int get_user_id_by_fd(int client_fd);
-    std::string generate_token();
     bool is_valid_token(const std::string& token);
     bool is_user_online(int user_id);  // 检查用户是否在线
-    void remove_online_user_by_fd(int client_fd);  // 根据 socket fd 移除在线用户
-    // 获取用户信息
-    std::unordered_map<int, User>& get_online_users();
-    std::mutex& get_users_mutex();
+    
+    // 会话过期：登录、心跳和每个认证通过的请求都会推迟过期时间，仍有推送连接
+    // （WebSocket、SSE 或挂起的长轮询）的用户到期时重新计时；
+    // 过期的会话连同其 token 一起移除，并向同群组的在线成员推送离线事件
+    void set_session_ttl(int ttl_seconds);
+    void expire_sessions();  // 由服务器主线程定期调用
     
 private:
     Database* db;
-    std::unordered_map<int, User> online_users;
-    std::unordered_map<std::string, int> token_to_user_id;  // token到用户ID的映射
-    std::mutex users_mutex;
+    GroupFanout* group_fanout;
+    PushHub* push_hub;
+    UserDirectory directory;  // 全部用户的ID与用户名，启动时载入，注册时追加
+    SessionTable sessions;    // 在线用户的登录会话
+    
+    // 推送在线状态变化给同群组的在线成员
+    void publish_presence(const User& user, bool online);
 };
 
 #endif // USER_MANAGER_H
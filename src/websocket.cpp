@@ -0,0 +1,134 @@
+#include "websocket.h"
+#include "common.h"
+#include <openssl/evp.h>
+#include <cctype>
+
+namespace {
+
+const char* WEBSOCKET_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+// value 是否包含不区分大小写的 token（用于 Connection: keep-alive, Upgrade）
+bool contains_token(std::string_view value, std::string_view token) {
+    if (value.length() < token.length()) {
+        return false;
+    }
+    for (size_t i = 0; i + token.length() <= value.length(); ++i) {
+        size_t j = 0;
+        while (j < token.length() &&
+               std::tolower(static_cast<unsigned char>(value[i + j])) == token[j]) {
+            ++j;
+        }
+        if (j == token.length()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string websocket_accept_key(std::string_view client_key) {
+    std::string input(client_key);
+    input += WEBSOCKET_GUID;
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_len = 0;
+    EVP_Digest(input.data(), input.length(), digest, &digest_len, EVP_sha1(), nullptr);
+    return base64_encode(std::string(reinterpret_cast<char*>(digest), digest_len));
+}
+
+}  // namespace
+
+FrameStatus parse_websocket_frame(const std::string& buffer, WebSocketFrame& frame) {
+    if (buffer.size() < 2) {
+        return FrameStatus::INCOMPLETE;
+    }
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(buffer.data());
+    frame.fin = (data[0] & 0x80) != 0;
+    frame.opcode = static_cast<WebSocketOpcode>(data[0] & 0x0F);
+    bool masked = (data[1] & 0x80) != 0;
+    uint64_t payload_len = data[1] & 0x7F;
+
+    // 未协商扩展时 RSV 位必须为 0，客户端帧必须带掩码
+    if ((data[0] & 0x70) != 0 || !masked) {
+        return FrameStatus::BAD_REQUEST;
+    }
+    bool is_control = (data[0] & 0x08) != 0;
+    if (is_control && (!frame.fin || payload_len > 125)) {
+        return FrameStatus::BAD_REQUEST;
+    }
+
+    size_t pos = 2;
+    if (payload_len == 126) {
+        if (buffer.size() < pos + 2) {
+            return FrameStatus::INCOMPLETE;
+        }
+        payload_len = (static_cast<uint64_t>(data[2]) << 8) | data[3];
+        pos += 2;
+    } else if (payload_len == 127) {
+        if (buffer.size() < pos + 8) {
+            return FrameStatus::INCOMPLETE;
+        }
+        payload_len = 0;
+        for (int i = 0; i < 8; ++i) {
+            payload_len = (payload_len << 8) | data[pos + i];
+        }
+        pos += 8;
+    }
+    if (payload_len > MAX_WEBSOCKET_PAYLOAD) {
+        return FrameStatus::TOO_LARGE;
+    }
+
+    if (buffer.size() < pos + 4 + payload_len) {
+        return FrameStatus::INCOMPLETE;
+    }
+    const unsigned char* mask = data + pos;
+    pos += 4;
+
+    frame.payload.resize(payload_len);
+    for (size_t i = 0; i < payload_len; ++i) {
+        frame.payload[i] = static_cast<char>(data[pos + i] ^ mask[i % 4]);
+    }
+    frame.length = pos + payload_len;
+    return FrameStatus::COMPLETE;
+}
+
+std::string encode_websocket_frame(WebSocketOpcode opcode, std::string_view payload) {
+    std::string frame;
+    frame.reserve(payload.length() + 10);
+    frame += static_cast<char>(0x80 | static_cast<uint8_t>(opcode));
+    if (payload.length() < 126) {
+        frame += static_cast<char>(payload.length());
+    } else if (payload.length() <= 0xFFFF) {
+        frame += static_cast<char>(126);
+        frame += static_cast<char>((payload.length() >> 8) & 0xFF);
+        frame += static_cast<char>(payload.length() & 0xFF);
+    } else {
+        frame += static_cast<char>(127);
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            frame += static_cast<char>((static_cast<uint64_t>(payload.length()) >> shift) & 0xFF);
+        }
+    }
+    frame.append(payload);
+    return frame;
+}
+
+std::string encode_websocket_close(uint16_t code) {
+    char payload[2] = {static_cast<char>(code >> 8), static_cast<char>(code & 0xFF)};
+    return encode_websocket_frame(WebSocketOpcode::CLOSE, std::string_view(payload, sizeof(payload)));
+}
+
+bool is_websocket_handshake(const HttpRequest& request) {
+    return request.method == "GET" &&
+           contains_token(request.header("Upgrade"), "websocket") &&
+           contains_token(request.header("Connection"), "upgrade") &&
+           request.header("Sec-WebSocket-Version") == "13" &&
+           request.header("Sec-WebSocket-Key").length() == 24;
+}
+
+HttpResponse create_websocket_handshake_response(const HttpRequest& request,
+                                                 HttpResponse::ConnectionHandler on_upgrade) {
+    std::string head = "HTTP/1.1 101 Switching Protocols\r\n"
+                       "Upgrade: websocket\r\n"
+                       "Connection: Upgrade\r\n"
+                       "Sec-WebSocket-Accept: " + websocket_accept_key(request.header("Sec-WebSocket-Key")) + "\r\n"
+                       "\r\n";
+    return HttpResponse::switching_protocols(std::move(head), std::move(on_upgrade));
+}
@@ -0,0 +1,52 @@
+#ifndef WEBSOCKET_H
+#define WEBSOCKET_H
+
+#include "http_parser.h"
+#include "http_response.h"
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+// RFC 6455 WebSocket：握手和帧编解码
+// 服务器只用于推送，客户端发来的数据帧被忽略，只处理 ping 和 close
+
+enum class WebSocketOpcode : uint8_t {
+    CONTINUATION = 0x0,
+    TEXT = 0x1,
+    BINARY = 0x2,
+    CLOSE = 0x8,
+    PING = 0x9,
+    PONG = 0xA
+};
+
+// 客户端帧的负载上限
+const size_t MAX_WEBSOCKET_PAYLOAD = 64 * 1024;
+
+// 常用的关闭状态码
+const uint16_t WS_CLOSE_NORMAL = 1000;
+const uint16_t WS_CLOSE_GOING_AWAY = 1001;
+const uint16_t WS_CLOSE_PROTOCOL_ERROR = 1002;
+const uint16_t WS_CLOSE_TOO_LARGE = 1009;
+
+struct WebSocketFrame {
+    size_t length;            // 帧在缓冲区中占用的总字节数
+    bool fin;
+    WebSocketOpcode opcode;
+    std::string payload;      // 已去掉掩码
+};
+
+// 从 buffer 开头解析一个客户端帧（客户端帧必须带掩码）
+FrameStatus parse_websocket_frame(const std::string& buffer, WebSocketFrame& frame);
+
+// 编码一个服务器帧（不带掩码、不分片）
+std::string encode_websocket_frame(WebSocketOpcode opcode, std::string_view payload);
+std::string encode_websocket_close(uint16_t code);
+
+// 请求是否为 WebSocket 握手（GET + Upgrade: websocket + 版本 13 + Sec-WebSocket-Key）
+bool is_websocket_handshake(const HttpRequest& request);
+
+// 生成握手的 101 响应，连接发送后切换为 WebSocket，并调用 on_upgrade
+HttpResponse create_websocket_handshake_response(const HttpRequest& request,
+                                                 HttpResponse::ConnectionHandler on_upgrade);
+
+#endif // WEBSOCKET_H